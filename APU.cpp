@@ -1,116 +1,685 @@
 #include "APU.hpp"
+#include "AudioOutput.hpp"
+#include <algorithm>
+#include <cmath>
 
 using namespace CPU;
 
+static const int CLOCK_RATE = 4194304;
+static const int CYCLES_PER_SEQUENCER_STEP = 8192;  // 512 Hz
+static const u32 MAX_PENDING_CLOCKS = 70224 * 2;    // Sin EndFrame (lockstep), sintetiza cada 2 frames
+static const size_t LOG_CAPACITY = 2048;
+
+static const u8 DUTY_TABLE[4][8] = {
+    {0, 0, 0, 0, 0, 0, 0, 1},   // 12.5%
+    {1, 0, 0, 0, 0, 0, 0, 1},   // 25%
+    {1, 0, 0, 0, 0, 1, 1, 1},   // 50%
+    {0, 1, 1, 1, 1, 1, 1, 0},   // 75%
+};
+
+static const int NOISE_DIVISORS[8] = {8, 16, 32, 48, 64, 80, 96, 112};
+
+// Bits que se leen siempre en 1 (0xFF10-0xFF3F); NR52 se arma aparte
+static const u8 READ_MASK[0x30] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,           // NR10-NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,           // -, NR21-NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,           // NR30-NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,           // -, NR41-NR44
+    0x00, 0x00, 0x70,                       // NR50-NR52
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// Secuencias de los LFSR de 15 y 7 bits (x^15+x^14+1 y x^7+x^6+1, periodos 32767 y 127).
+// Con la posicion de un estado en su ciclo, avanzar N pasos es sumar N, y cuantos de los
+// estados intermedios dan salida alta (bit 0 en 0) sale de un popcount sobre 'high'.
+struct LfsrTable {
+    int period = 0;
+    std::vector<u16> states;    // Posicion -> estado
+    std::vector<u16> index;     // Estado -> posicion
+    std::vector<u64> high;      // Bit i: salida alta en la posicion i (repetido 128 bits de mas)
+
+    explicit LfsrTable(int width) {
+        index.assign(1 << width, 0);
+        u16 state = (1 << width) - 1;
+        do {
+            index[state] = (u16)states.size();
+            states.push_back(state);
+            u16 xor_bit = (state ^ (state >> 1)) & 0x01;
+            state = (state >> 1) | (xor_bit << (width - 1));
+        } while (state != states[0]);
+        period = (int)states.size();
+
+        high.assign((period + 128) / 64 + 2, 0);
+        for (int i = 0; i < period + 128; i++) {
+            if (!(states[i % period] & 0x01)) high[i / 64] |= 1ull << (i % 64);
+        }
+    }
+
+    // Estados con salida alta entre las posiciones first y first+count-1 (count <= 64)
+    int CountHigh(int first, int count) const {
+        int word = first / 64, bit = first % 64;
+        u64 window = high[word] >> bit;
+        if (bit) window |= high[word + 1] << (64 - bit);
+        if (count < 64) window &= (1ull << count) - 1;
+        return __builtin_popcountll(window);
+    }
+};
+static const LfsrTable LFSR15(15);
+static const LfsrTable LFSR7(7);
+
+// Avanza el LFSR 'steps' pasos de una vez y anota cuantos quedaron en alto. En modo corto
+// los bits 0-6 son un LFSR de 7 bits y, pasados 8 pasos, los de arriba se deducen de ellos.
+static void StepNoise(NoiseChannel& ch, int steps) {
+    ch.group_steps = (u8)steps;
+    if (!ch.short_mode) {
+        // Todo en 0 (se llega cortando a 15 bits despues de bloquear el de 7): no sale de ahi
+        if ((ch.lfsr & 0x7FFF) == 0) {
+            ch.group_high = (u8)steps;
+            return;
+        }
+        int i = LFSR15.index[ch.lfsr & 0x7FFF];
+        ch.group_high = (u8)LFSR15.CountHigh(i + 1, steps);
+        ch.lfsr = LFSR15.states[(i + steps) % LFSR15.period];
+        return;
+    }
+
+    // 7 bits en 0 no esta en el ciclo de 127: queda bloqueado con la salida alta. Los bits
+    // altos se siguen corriendo (el loop lo hace) y a los 8 pasos el registro entero es 0.
+    bool locked = (ch.lfsr & 0x7F) == 0;
+    int i = LFSR7.index[ch.lfsr & 0x7F];
+    ch.group_high = locked ? (u8)steps : (u8)LFSR7.CountHigh(i + 1, steps);
+    if (steps < 8) {
+        for (int s = 0; s < steps; s++) {
+            u16 xor_bit = (ch.lfsr ^ (ch.lfsr >> 1)) & 0x01;
+            ch.lfsr = (ch.lfsr >> 1) | (xor_bit << 14);
+            ch.lfsr = (ch.lfsr & ~0x40) | (xor_bit << 6);
+        }
+        return;
+    }
+    if (locked) {
+        ch.lfsr = 0;
+        return;
+    }
+    u16 low = LFSR7.states[(i + steps) % LFSR7.period];
+    u16 previous = LFSR7.states[(i + steps - 1) % LFSR7.period];
+    ch.lfsr = low | (low << 8) | ((previous & 0x01) << 7);
+}
+
+static int SquarePeriod(const SquareChannel& ch) { return (2048 - ch.frequency) * 4; }
+static int WavePeriod(const WaveChannel& ch) { return (2048 - ch.frequency) * 2; }
+static int NoisePeriod(const NoiseChannel& ch) { return NOISE_DIVISORS[ch.divisor_code] << ch.clock_shift; }
+
+static void WriteEnvelope(Envelope& env, bool& dac, bool& enabled, u8 value) {
+    env.initial = value >> 4;
+    env.increase = (value & 0x08) != 0;
+    env.period = value & 0x07;
+    dac = (value & 0xF8) != 0;
+    if (!dac) enabled = false;
+}
+
+static void ClockEnvelope(Envelope& env) {
+    if (env.period == 0) return;
+    if (env.timer > 0) env.timer--;
+    if (env.timer == 0) {
+        env.timer = env.period;
+        if (env.increase && env.volume < 15) env.volume++;
+        else if (!env.increase && env.volume > 0) env.volume--;
+    }
+}
+
+template <typename Channel>
+static void ClockLength(Channel& ch) {
+    if (ch.length_enabled && ch.length > 0 && --ch.length == 0) ch.enabled = false;
+}
+
 APU::APU() {
-    audio_cycles = 0;
-    phase1 = 0.0f; 
-    phase2 = 0.0f; 
-    phase3 = 0.0f; 
-    phase4 = 0.0f;
-    lfsr = 0x7FFF;
     onda_pasada_entrada = 0.0f;
     onda_pasada_salida = 0.0f;
-    
-    sample_buffer.reserve(2048);
+
+    write_log.reserve(LOG_CAPACITY);
+    ready.reserve(8192);
+    SetSampleRate(sample_rate);
+}
+
+void APU::SetBatched(bool enabled) {
+    Sync();
+    batched = enabled;
+}
+
+void APU::SetSampleRate(int rate) {
+    sample_rate = std::max(8000, std::min(rate, 192000));
+    blip.SetRates(CLOCK_RATE, sample_rate, CYCLES_PER_SEQUENCER_STEP);
+    blip.Clear(levels[0] + levels[1] + levels[2] + levels[3]);
+    // Mismo corte del pasa altos que 0.995 a 44100 Hz
+    hpf_factor = (float)std::pow(0.995, 44100.0 / sample_rate);
+    noise_group_clocks = CLOCK_RATE / sample_rate;
+    samples.resize(CYCLES_PER_SEQUENCER_STEP * (size_t)sample_rate * 101 / 100 / CLOCK_RATE + 4);
+}
+
+// Campo por campo, como el resto del estado: los structs tienen padding y su layout
+// depende del compilador
+static void SaveEnvelope(StateWriter& state, const Envelope& envelope) {
+    state.Put(envelope.initial);
+    state.Put(envelope.volume);
+    state.Put(envelope.increase);
+    state.Put(envelope.period);
+    state.Put(envelope.timer);
 }
 
-void APU::Tick(int cycles, Memory_Bus& bus, SDL_AudioDeviceID device) {
-    audio_cycles += cycles;
+static void LoadEnvelope(StateReader& state, Envelope& envelope) {
+    state.Get(envelope.initial);
+    state.Get(envelope.volume);
+    state.Get(envelope.increase);
+    state.Get(envelope.period);
+    state.Get(envelope.timer);
+}
 
-    while (audio_cycles >= 95) {
-        audio_cycles -= 95;
+static void SaveSquare(StateWriter& state, const SquareChannel& square) {
+    state.Put(square.enabled);
+    state.Put(square.dac);
+    state.Put(square.duty);
+    state.Put(square.duty_pos);
+    state.Put(square.frequency);
+    state.Put(square.timer);
+    state.Put(square.length);
+    state.Put(square.length_enabled);
+    SaveEnvelope(state, square.envelope);
+    state.Put(square.sweep_period);
+    state.Put(square.sweep_shift);
+    state.Put(square.sweep_negate);
+    state.Put(square.sweep_timer);
+    state.Put(square.sweep_enabled);
+    state.Put(square.shadow_frequency);
+}
 
-        float sample1 = 0.0f, sample2 = 0.0f, sample3 = 0.0f, sample4 = 0.0f;
+static void LoadSquare(StateReader& state, SquareChannel& square) {
+    state.Get(square.enabled);
+    state.Get(square.dac);
+    state.Get(square.duty);
+    state.Get(square.duty_pos);
+    state.Get(square.frequency);
+    state.Get(square.timer);
+    state.Get(square.length);
+    state.Get(square.length_enabled);
+    LoadEnvelope(state, square.envelope);
+    state.Get(square.sweep_period);
+    state.Get(square.sweep_shift);
+    state.Get(square.sweep_negate);
+    state.Get(square.sweep_timer);
+    state.Get(square.sweep_enabled);
+    state.Get(square.shadow_frequency);
+}
 
-        // CHANNEL 1
-        u8 nr11 = bus.Read(0xFF11), nr12 = bus.Read(0xFF12), nr13 = bus.Read(0xFF13), nr14 = bus.Read(0xFF14);
-        int vol1 = (nr12 >> 4) & 0x0F;
-        if (vol1 > 0) {
-            u16 freq1 = nr13 | ((nr14 & 0x07) << 8);
-            float hz1 = 131072.0f / (2048.0f - freq1);
-            phase1 += hz1 / 44100.0f;
-            if (phase1 >= 1.0f) phase1 -= 1.0f;
-            int duty_idx = (nr11 >> 6) & 0x03;
-            float duty = (duty_idx == 0) ? 0.125f : (duty_idx == 1) ? 0.25f : (duty_idx == 2) ? 0.5f : 0.75f;
-            sample1 = ((phase1 < duty) ? 1.0f : -1.0f) * (vol1 / 15.0f);
+static void SaveWave(StateWriter& state, const WaveChannel& wave) {
+    state.Put(wave.enabled);
+    state.Put(wave.dac);
+    state.Put(wave.volume_code);
+    state.Put(wave.frequency);
+    state.Put(wave.timer);
+    state.Put(wave.position);
+    state.Put(wave.sample);
+    state.Put(wave.length);
+    state.Put(wave.length_enabled);
+}
+
+static void LoadWave(StateReader& state, WaveChannel& wave) {
+    state.Get(wave.enabled);
+    state.Get(wave.dac);
+    state.Get(wave.volume_code);
+    state.Get(wave.frequency);
+    state.Get(wave.timer);
+    state.Get(wave.position);
+    state.Get(wave.sample);
+    state.Get(wave.length);
+    state.Get(wave.length_enabled);
+}
+
+static void SaveNoise(StateWriter& state, const NoiseChannel& noise) {
+    state.Put(noise.enabled);
+    state.Put(noise.dac);
+    SaveEnvelope(state, noise.envelope);
+    state.Put(noise.clock_shift);
+    state.Put(noise.divisor_code);
+    state.Put(noise.short_mode);
+    state.Put(noise.lfsr);
+    state.Put(noise.timer);
+    state.Put(noise.group_steps);
+    state.Put(noise.group_high);
+    state.Put(noise.length);
+    state.Put(noise.length_enabled);
+}
+
+static void LoadNoise(StateReader& state, NoiseChannel& noise) {
+    state.Get(noise.enabled);
+    state.Get(noise.dac);
+    LoadEnvelope(state, noise.envelope);
+    state.Get(noise.clock_shift);
+    state.Get(noise.divisor_code);
+    state.Get(noise.short_mode);
+    state.Get(noise.lfsr);
+    state.Get(noise.timer);
+    state.Get(noise.group_steps);
+    state.Get(noise.group_high);
+    state.Get(noise.length);
+    state.Get(noise.length_enabled);
+}
+
+void APU::SaveState(StateWriter& state) const {
+    state.Put(powered);
+    state.Bytes(regs, sizeof(regs));
+    SaveSquare(state, square[0]);
+    SaveSquare(state, square[1]);
+    SaveWave(state, wave);
+    SaveNoise(state, noise);
+    state.Put(sequencer_timer);
+    state.Put(sequencer_step);
+    state.Put(levels);
+    state.Put(onda_pasada_entrada);
+    state.Put(onda_pasada_salida);
+    state.Put(pending_clocks);
+    u32 log_size = (u32)write_log.size();
+    state.Put(log_size);
+    for (const RegisterWrite& write : write_log) {
+        state.Put(write.time);
+        state.Put(write.address);
+        state.Put(write.value);
+    }
+}
+
+void APU::LoadState(StateReader& state) {
+    state.Get(powered);
+    state.Bytes(regs, sizeof(regs));
+    LoadSquare(state, square[0]);
+    LoadSquare(state, square[1]);
+    LoadWave(state, wave);
+    LoadNoise(state, noise);
+    state.Get(sequencer_timer);
+    state.Get(sequencer_step);
+    state.Get(levels);
+    state.Get(onda_pasada_entrada);
+    state.Get(onda_pasada_salida);
+    state.Get(pending_clocks);
+    u32 log_size = 0;
+    state.Get(log_size);
+    if (log_size > LOG_CAPACITY) state.ok = false;
+    write_log.resize(state.ok ? log_size : 0);
+    for (RegisterWrite& write : write_log) {
+        state.Get(write.time);
+        state.Get(write.address);
+        state.Get(write.value);
+        write.unused = 0;
+    }
+    ready.clear();
+    // Los deltas pendientes no se guardan: el blip arranca quieto en el nivel actual
+    blip.Clear(levels[0] + levels[1] + levels[2] + levels[3]);
+}
+
+// NR52 bit 7 en 0: se borran NR10-NR51 y se apagan los canales; la wave RAM queda
+void APU::PowerOff() {
+    powered = false;
+    std::fill(regs, regs + 0x16, 0);
+    square[0] = SquareChannel();
+    square[1] = SquareChannel();
+    wave = WaveChannel();
+    u16 lfsr = noise.lfsr;
+    noise = NoiseChannel();
+    noise.lfsr = lfsr;
+    UpdateLevels();
+}
+
+u16 APU::SweepTarget() {
+    SquareChannel& ch = square[0];
+    u16 delta = ch.shadow_frequency >> ch.sweep_shift;
+    u16 target = ch.sweep_negate ? ch.shadow_frequency - delta : ch.shadow_frequency + delta;
+    if (target > 2047) ch.enabled = false;
+    return target;
+}
+
+void APU::Trigger(int channel) {
+    switch (channel) {
+        case 0:
+        case 1: {
+            SquareChannel& ch = square[channel];
+            ch.enabled = ch.dac;
+            if (ch.length == 0) ch.length = 64;
+            ch.timer = SquarePeriod(ch);
+            ch.envelope.volume = ch.envelope.initial;
+            ch.envelope.timer = ch.envelope.period;
+            if (channel == 0) {
+                ch.shadow_frequency = ch.frequency;
+                ch.sweep_timer = ch.sweep_period ? ch.sweep_period : 8;
+                ch.sweep_enabled = ch.sweep_period || ch.sweep_shift;
+                if (ch.sweep_shift) SweepTarget();
+            }
+            break;
         }
+        case 2:
+            wave.enabled = wave.dac;
+            if (wave.length == 0) wave.length = 256;
+            wave.timer = WavePeriod(wave);
+            wave.position = 0;
+            break;
+        case 3:
+            noise.enabled = noise.dac;
+            if (noise.length == 0) noise.length = 64;
+            noise.timer = NoisePeriod(noise);
+            noise.envelope.volume = noise.envelope.initial;
+            noise.envelope.timer = noise.envelope.period;
+            noise.lfsr = 0x7FFF;
+            noise.group_steps = 1;
+            noise.group_high = 0;
+            break;
+    }
+}
 
-        // CHANNEL 2
-        u8 nr21 = bus.Read(0xFF16), nr22 = bus.Read(0xFF17), nr23 = bus.Read(0xFF18), nr24 = bus.Read(0xFF19);
-        int vol2 = (nr22 >> 4) & 0x0F;
-        if (vol2 > 0) {
-            u16 freq2 = nr23 | ((nr24 & 0x07) << 8);
-            float hz2 = 131072.0f / (2048.0f - freq2);
-            phase2 += hz2 / 44100.0f;
-            if (phase2 >= 1.0f) phase2 -= 1.0f;
-            int duty_idx = (nr21 >> 6) & 0x03;
-            float duty = (duty_idx == 0) ? 0.125f : (duty_idx == 1) ? 0.25f : (duty_idx == 2) ? 0.5f : 0.75f;
-            sample2 = ((phase2 < duty) ? 1.0f : -1.0f) * (vol2 / 15.0f);
+void APU::WriteRegister(u16 address, u8 value) {
+    if (!batched) {
+        ApplyWrite(address, value);
+        return;
+    }
+    if (write_log.size() == LOG_CAPACITY) Sync();
+    write_log.push_back({pending_clocks, address, value, 0});
+}
+
+void APU::ApplyWrite(u16 address, u8 value) {
+    int reg = address - 0xFF10;
+
+    // La wave RAM se puede escribir siempre
+    if (address >= 0xFF30) {
+        regs[reg] = value;
+        return;
+    }
+    if (address == 0xFF26) {
+        if (!(value & 0x80)) {
+            if (powered) PowerOff();
+        } else if (!powered) {
+            powered = true;
+            sequencer_step = 0;
         }
+        return;
+    }
+    if (!powered) return;
+    regs[reg] = value;
 
-        // CHANNEL 3
-        u8 nr30 = bus.Read(0xFF1A);
-        if (nr30 & 0x80) { 
-            u8 nr32 = bus.Read(0xFF1C);
-            int vol_shift = (nr32 >> 5) & 0x03; // 0=Mute, 1=100%, 2=50%, 3=25%
-            
-            if (vol_shift > 0) {
-                u16 freq3 = bus.Read(0xFF1D) | ((bus.Read(0xFF1E) & 0x07) << 8);
-                float hz3 = 65536.0f / (2048.0f - freq3);
-                
-                phase3 += (hz3 * 32.0f) / 44100.0f; // 32 muestras por ciclo de onda
-                if (phase3 >= 32.0f) phase3 -= 32.0f;
-
-                int sample_idx = (int)phase3;
-                
-                u8 wave_byte = bus.Read(0xFF30 + (sample_idx / 2));
-                
-                u8 nibble = (sample_idx % 2 == 0) ? (wave_byte >> 4) : (wave_byte & 0x0F);
-                
-                int shift_amount = (vol_shift == 1) ? 0 : (vol_shift == 2) ? 1 : 2;
-                float wave_sample = (float)(nibble >> shift_amount);
-                
-                sample3 = ((wave_sample / 7.5f) - 1.0f); // Normalizar entre -1.0 y 1.0
-            }
+    switch (address) {
+        case 0xFF10:
+            square[0].sweep_period = (value >> 4) & 0x07;
+            square[0].sweep_negate = (value & 0x08) != 0;
+            square[0].sweep_shift = value & 0x07;
+            break;
+        case 0xFF11:
+        case 0xFF16: {
+            SquareChannel& ch = square[address == 0xFF16];
+            ch.duty = value >> 6;
+            ch.length = 64 - (value & 0x3F);
+            break;
+        }
+        case 0xFF12:
+        case 0xFF17: {
+            SquareChannel& ch = square[address == 0xFF17];
+            WriteEnvelope(ch.envelope, ch.dac, ch.enabled, value);
+            break;
         }
+        case 0xFF13:
+        case 0xFF18: {
+            SquareChannel& ch = square[address == 0xFF18];
+            ch.frequency = (ch.frequency & 0x700) | value;
+            break;
+        }
+        case 0xFF14:
+        case 0xFF19: {
+            int channel = address == 0xFF19;
+            SquareChannel& ch = square[channel];
+            ch.frequency = (ch.frequency & 0xFF) | ((value & 0x07) << 8);
+            ch.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) Trigger(channel);
+            break;
+        }
+        case 0xFF1A:
+            wave.dac = (value & 0x80) != 0;
+            if (!wave.dac) wave.enabled = false;
+            break;
+        case 0xFF1B:
+            wave.length = 256 - value;
+            break;
+        case 0xFF1C:
+            wave.volume_code = (value >> 5) & 0x03;
+            break;
+        case 0xFF1D:
+            wave.frequency = (wave.frequency & 0x700) | value;
+            break;
+        case 0xFF1E:
+            wave.frequency = (wave.frequency & 0xFF) | ((value & 0x07) << 8);
+            wave.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) Trigger(2);
+            break;
+        case 0xFF20:
+            noise.length = 64 - (value & 0x3F);
+            break;
+        case 0xFF21:
+            WriteEnvelope(noise.envelope, noise.dac, noise.enabled, value);
+            break;
+        case 0xFF22:
+            noise.clock_shift = value >> 4;
+            noise.short_mode = (value & 0x08) != 0;
+            noise.divisor_code = value & 0x07;
+            break;
+        case 0xFF23:
+            noise.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) Trigger(3);
+            break;
+    }
+    UpdateLevels();
+}
+
+u8 APU::ReadRegister(u16 address) {
+    if (batched) Sync();
+    int reg = address - 0xFF10;
+    if (address >= 0xFF30) return regs[reg];
+    if (address == 0xFF26) {
+        return (powered ? 0x80 : 0x00) | 0x70 |
+               (square[0].enabled ? 0x01 : 0) | (square[1].enabled ? 0x02 : 0) |
+               (wave.enabled ? 0x04 : 0) | (noise.enabled ? 0x08 : 0);
+    }
+    return regs[reg] | READ_MASK[reg];
+}
 
-        // CHANNAL 4
-        u8 nr42 = bus.Read(0xFF21);
-        int vol4 = (nr42 >> 4) & 0x0F;
-        if (vol4 > 0) {
-            u8 nr43 = bus.Read(0xFF22);
-            int shift = (nr43 >> 4) & 0x0F;
-            int divisor_code = nr43 & 0x07;
-            float divisor = (divisor_code == 0) ? 8.0f : (divisor_code * 16.0f);
-            float freq4 = 4194304.0f / (divisor * (1 << shift));
-
-            phase4 += freq4 / 44100.0f;
-            while (phase4 >= 1.0f) {
-                phase4 -= 1.0f;
-                int xor_bit = (lfsr & 0x01) ^ ((lfsr >> 1) & 0x01);
-                lfsr >>= 1;
-                lfsr |= (xor_bit << 14);
-                if (nr43 & 0x08) {
-                    lfsr &= ~0x40;
-                    lfsr |= (xor_bit << 6);
+// Pasos pares: largo; 2 y 6: sweep; 7: envolventes
+void APU::ClockSequencer() {
+    u8 step = sequencer_step;
+    sequencer_step = (sequencer_step + 1) & 0x07;
+
+    if ((step & 1) == 0) {
+        ClockLength(square[0]);
+        ClockLength(square[1]);
+        ClockLength(wave);
+        ClockLength(noise);
+    }
+    if (step == 2 || step == 6) {
+        SquareChannel& ch = square[0];
+        if (ch.sweep_timer > 0) ch.sweep_timer--;
+        if (ch.sweep_timer == 0) {
+            ch.sweep_timer = ch.sweep_period ? ch.sweep_period : 8;
+            if (ch.sweep_enabled && ch.sweep_period) {
+                u16 target = SweepTarget();
+                if (target <= 2047 && ch.sweep_shift) {
+                    ch.frequency = ch.shadow_frequency = target;
+                    SweepTarget();
                 }
             }
-            sample4 = (((lfsr & 0x01) ? -1.0f : 1.0f) * (vol4 / 15.0f)) * 0.2f;
         }
+    }
+    if (step == 7) {
+        ClockEnvelope(square[0].envelope);
+        ClockEnvelope(square[1].envelope);
+        ClockEnvelope(noise.envelope);
+    }
+}
+
+// Clocks desde el ultimo FlushSamples (se vacia en cada paso del sequencer)
+u32 APU::FrameTime() const {
+    return CYCLES_PER_SEQUENCER_STEP - sequencer_timer;
+}
+
+// Salida digital 0-15 de cada canal; el DAC la lleva a -1..1 (DAC apagado = 0).
+// NR51 elige a que lado va y NR50 el volumen de cada lado; la salida es mono.
+float APU::ChannelLevel(int channel) const {
+    static const u8 WAVE_SHIFT[4] = {4, 0, 1, 2};
+    float digital;
+    switch (channel) {
+        case 0:
+        case 1: {
+            const SquareChannel& ch = square[channel];
+            if (!ch.dac) return 0.0f;
+            digital = ch.enabled && DUTY_TABLE[ch.duty][ch.duty_pos] ? ch.envelope.volume : 0;
+            break;
+        }
+        case 2:
+            if (!wave.dac) return 0.0f;
+            digital = wave.enabled ? wave.sample >> WAVE_SHIFT[wave.volume_code] : 0;
+            break;
+        default:
+            if (!noise.dac) return 0.0f;
+            // Promedio del grupo de pasos (con un solo paso, 0 o el volumen)
+            digital = noise.enabled ? (float)(noise.envelope.volume * noise.group_high) / noise.group_steps : 0.0f;
+            break;
+    }
 
-        float entrada = (sample1 + sample2 + sample3 + sample4) * 0.05f;
+    u8 nr50 = regs[0x14], nr51 = regs[0x15];
+    int gain = ((nr51 >> (4 + channel)) & 1) * (((nr50 >> 4) & 0x07) + 1) +
+               ((nr51 >> channel) & 1) * ((nr50 & 0x07) + 1);
+    return (digital / 7.5f - 1.0f) * gain * (0.05f / 16.0f);
+}
 
-        float salida = entrada - onda_pasada_entrada + 0.995f * onda_pasada_salida;
+void APU::UpdateLevel(int channel, u32 time) {
+    float level = ChannelLevel(channel);
+    if (level != levels[channel]) {
+        blip.AddDelta(channel, time, level - levels[channel]);
+        levels[channel] = level;
+    }
+}
+
+void APU::UpdateLevels() {
+    u32 time = FrameTime();
+    for (int i = 0; i < 4; i++) UpdateLevel(i, time);
+}
+
+// Avanza los timers paso a paso y anota cada cambio de nivel en su clock exacto
+void APU::AdvanceChannels(int cycles) {
+    u32 start = FrameTime();
+
+    for (int i = 0; i < 2; i++) {
+        SquareChannel& ch = square[i];
+        if (!ch.enabled) continue;
+        int left = cycles;
+        u32 time = start;
+        while (ch.timer <= left) {
+            left -= ch.timer;
+            time += ch.timer;
+            ch.timer = SquarePeriod(ch);
+            ch.duty_pos = (ch.duty_pos + 1) & 0x07;
+            UpdateLevel(i, time);
+        }
+        ch.timer -= left;
+    }
+
+    if (wave.enabled) {
+        int left = cycles;
+        u32 time = start;
+        while (wave.timer <= left) {
+            left -= wave.timer;
+            time += wave.timer;
+            wave.timer = WavePeriod(wave);
+            wave.position = (wave.position + 1) & 0x1F;
+            u8 byte = regs[0x20 + wave.position / 2];
+            wave.sample = (wave.position & 1) ? (byte & 0x0F) : (byte >> 4);
+            UpdateLevel(2, time);
+        }
+        wave.timer -= left;
+    }
+
+    // Ruido: si entran varios pasos del LFSR en una muestra de salida se avanzan juntos y
+    // el nivel es el promedio del grupo; el costo queda acotado por muestra, no por paso
+    if (noise.enabled) {
+        int left = cycles;
+        u32 time = start;
+        while (noise.timer <= left) {
+            left -= noise.timer;
+            time += noise.timer;
+            int period = NoisePeriod(noise);
+            int steps = std::min(64, std::max(1, noise_group_clocks / period));
+            StepNoise(noise, steps);
+            noise.timer = period * steps;
+            UpdateLevel(3, time);
+        }
+        noise.timer -= left;
+    }
+}
+
+void APU::FlushSamples() {
+    blip.EndFrame(CYCLES_PER_SEQUENCER_STEP);
+    int count = blip.ReadSamples(samples.data(), (int)samples.size());
+    blip.SetRatio(rate_adjust);
+
+    for (int i = 0; i < count; i++) {
+        float entrada = samples[i];
+
+        float salida = entrada - onda_pasada_entrada + hpf_factor * onda_pasada_salida;
 
         onda_pasada_entrada = entrada;
         onda_pasada_salida = salida;
+        samples[i] = salida;
+    }
+    ready.insert(ready.end(), samples.begin(), samples.begin() + count);
+}
 
-        sample_buffer.push_back(salida);
+void APU::Advance(int cycles) {
+    while (cycles > 0) {
+        int step = std::min(cycles, sequencer_timer);
+        if (powered) AdvanceChannels(step);
+        cycles -= step;
+        sequencer_timer -= step;
 
-        if (sample_buffer.size() >= 1024) {
-            SDL_QueueAudio(device, sample_buffer.data(), sample_buffer.size() * sizeof(float));
-            sample_buffer.clear();
+        if (sequencer_timer == 0) {
+            if (powered) ClockSequencer();
+            UpdateLevels();
+            sequencer_timer = CYCLES_PER_SEQUENCER_STEP;
+            FlushSamples();
         }
     }
-}
\ No newline at end of file
+}
+
+// Aplica las escrituras anotadas, cada una en su clock, y sintetiza hasta el presente
+void APU::Sync() {
+    u32 done = 0;
+    for (const RegisterWrite& write : write_log) {
+        Advance(write.time - done);
+        done = write.time;
+        ApplyWrite(write.address, write.value);
+    }
+    Advance(pending_clocks - done);
+    write_log.clear();
+    pending_clocks = 0;
+}
+
+void APU::Deliver(AudioOutput* output, std::vector<float>* capture) {
+    if (ready.empty()) return;
+    if (output) output->Push(ready.data(), ready.size());
+    if (capture) capture->insert(capture->end(), ready.begin(), ready.end());
+    ready.clear();
+}
+
+void APU::Tick(int cycles, AudioOutput* output, std::vector<float>* capture) {
+    if (batched) {
+        pending_clocks += cycles;
+        if (pending_clocks >= MAX_PENDING_CLOCKS) EndFrame(output, capture);
+        return;
+    }
+    Advance(cycles);
+    Deliver(output, capture);
+}
+
+void APU::EndFrame(AudioOutput* output, std::vector<float>* capture) {
+    Sync();
+    Deliver(output, capture);
+}
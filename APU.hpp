@@ -1,23 +1,143 @@
 #pragma once
 #include "CPU.hpp"
-#include <SDL2/SDL.h>
+#include "BlipBuffer.hpp"
 #include <vector>
 
 namespace CPU {
+    class AudioOutput;
+
+    struct Envelope {
+        u8 initial = 0;
+        u8 volume = 0;
+        bool increase = false;
+        u8 period = 0;
+        u8 timer = 0;
+    };
+
+    // Canales 1 y 2. El sweep solo lo usa el canal 1.
+    struct SquareChannel {
+        bool enabled = false;
+        bool dac = false;
+        u8 duty = 0;
+        u8 duty_pos = 0;
+        u16 frequency = 0;
+        int timer = 0;              // Clocks hasta el proximo paso del duty
+        u16 length = 0;
+        bool length_enabled = false;
+        Envelope envelope;
+
+        u8 sweep_period = 0;
+        u8 sweep_shift = 0;
+        bool sweep_negate = false;
+        u8 sweep_timer = 0;
+        bool sweep_enabled = false;
+        u16 shadow_frequency = 0;
+    };
+
+    struct WaveChannel {
+        bool enabled = false;
+        bool dac = false;
+        u8 volume_code = 0;         // NR32: 0=mute 1=100% 2=50% 3=25%
+        u16 frequency = 0;
+        int timer = 0;
+        u8 position = 0;            // 0-31, nibble de la wave RAM
+        u8 sample = 0;
+        u16 length = 0;
+        bool length_enabled = false;
+    };
+
+    struct NoiseChannel {
+        bool enabled = false;
+        bool dac = false;
+        Envelope envelope;
+        u8 clock_shift = 0;
+        u8 divisor_code = 0;
+        bool short_mode = false;    // LFSR de 7 bits
+        u16 lfsr = 0x7FFF;
+        int timer = 0;              // Clocks hasta el proximo grupo de pasos del LFSR
+        u8 group_steps = 1;         // Pasos del LFSR en el grupo actual
+        u8 group_high = 0;          // Cuantos de esos pasos dejaron la salida en alto
+        u16 length = 0;
+        bool length_enabled = false;
+    };
+
+    // El APU guarda el estado de los canales y lo actualiza solo cuando el CPU escribe
+    // NR10-NR52 o la wave RAM (Memory_Bus le pasa esas escrituras y lecturas). Tick avanza
+    // los timers de cada canal y el frame sequencer (512 Hz: largo, sweep y envolvente).
+    // Cada canal deja un delta en el BlipBuffer solo cuando cambia su nivel de salida (flanco
+    // del duty, nueva muestra de la wave, bit del LFSR, volumen, mezcla); en cada paso del
+    // sequencer se integran las muestras a la frecuencia de salida configurada.
+    //
+    // Modo por frame (el de siempre): Tick solo suma clocks y las escrituras a registros se
+    // anotan con su clock. EndFrame (o una lectura de un registro de sonido) las aplica en
+    // orden y sintetiza todo el tramo de una vez, canal por canal. El resultado es igual
+    // muestra a muestra al modo paso a paso (SetBatched(false)), que avanza en cada Tick.
     class APU {
     private:
-        int audio_cycles;
-        float phase1;
-        float phase2;
-        float phase3;
-        float phase4;
-        uint16_t lfsr;
-        std::vector<float> sample_buffer;
+        bool powered = false;
+        u8 regs[0x30] = {};         // 0xFF10-0xFF3F tal como se escribieron (wave RAM al final)
+        SquareChannel square[2];
+        WaveChannel wave;
+        NoiseChannel noise;
+
+        int sequencer_timer = 8192;
+        u8 sequencer_step = 0;
+
+        // Escritura pendiente en modo por frame; 'time' en clocks desde la ultima sintesis
+        struct RegisterWrite {
+            u32 time;
+            u16 address;
+            u8 value;
+            u8 unused;
+        };
+        bool batched = true;
+        u32 pending_clocks = 0;
+        std::vector<RegisterWrite> write_log;
+
+        BlipBuffer blip{4};
+        int sample_rate = 44100;
+        float levels[4] = {};       // Ultimo nivel que cada canal dejo en el blip
+        float hpf_factor = 0.995f;
+        int noise_group_clocks = 95;    // Clocks por muestra de salida
+        double rate_adjust = 1.0;
+        std::vector<float> samples;
+        std::vector<float> ready;   // Muestras generadas que falta entregar
         float onda_pasada_entrada;
         float onda_pasada_salida;
 
+        void PowerOff();
+        void Trigger(int channel);
+        u16 SweepTarget();
+        void ClockSequencer();
+        u32 FrameTime() const;
+        float ChannelLevel(int channel) const;
+        void UpdateLevel(int channel, u32 time);
+        void UpdateLevels();
+        void AdvanceChannels(int cycles);
+        void FlushSamples();
+        void ApplyWrite(u16 address, u8 value);
+        void Advance(int cycles);
+        void Sync();
+        void Deliver(AudioOutput* output, std::vector<float>* capture);
+
     public:
         APU();
-        void Tick(int cycles, Memory_Bus& bus, SDL_AudioDeviceID device);
+        void WriteRegister(u16 address, u8 value);
+        u8 ReadRegister(u16 address);   // Sincroniza antes si hay escrituras pendientes
+        // Frecuencia de salida en Hz (por defecto 44100)
+        void SetSampleRate(int rate);
+        int SampleRate() const { return sample_rate; }
+        // Control de ritmo: genera 'ratio' veces las muestras nominales (+-1% como mucho)
+        // (se aplica al empezar el proximo tramo del sequencer)
+        void SetRateAdjust(double ratio) { rate_adjust = ratio; }
+        // 'output': ring del callback de audio (nullptr = sin sonido). 'capture': si no es
+        // nullptr, cada muestra generada tambien se agrega ahi
+        void Tick(int cycles, AudioOutput* output, std::vector<float>* capture = nullptr);
+        // Fin de frame: en modo por frame sintetiza lo pendiente y entrega las muestras
+        void EndFrame(AudioOutput* output, std::vector<float>* capture = nullptr);
+        void SetBatched(bool enabled);
+        bool Batched() const { return batched; }
+        void SaveState(StateWriter& state) const;
+        void LoadState(StateReader& state);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,58 @@
+#include "AudioOutput.hpp"
+#include <algorithm>
+
+using namespace CPU;
+
+bool AudioOutput::Open(int rate, int latency_ms) {
+    Close();
+
+    // El buffer de SDL es potencia de 2 y no pasa de un cuarto de la latencia pedida
+    size_t wanted = (size_t)rate * std::max(latency_ms, 1) / 1000;
+    Uint16 chunk = 256;
+    while (chunk < 4096 && chunk * 4 <= wanted) chunk *= 2;
+
+    SDL_AudioSpec wanted_spec;
+    SDL_zero(wanted_spec);
+    wanted_spec.freq = rate;
+    wanted_spec.format = AUDIO_F32SYS;  // Flotantes de 32 bits (-1.0 a 1.0)
+    wanted_spec.channels = 1;           // Mono
+    wanted_spec.samples = chunk;
+    wanted_spec.callback = Callback;
+    wanted_spec.userdata = this;
+
+    device = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, nullptr, 0);
+    if (device == 0) return false;
+
+    sample_rate = rate;
+    target = std::min(std::max(wanted, (size_t)chunk), RING_SAMPLES / 2);
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+void AudioOutput::Close() {
+    if (device != 0) SDL_CloseAudioDevice(device);
+    device = 0;
+}
+
+void AudioOutput::Push(const float* samples, size_t count) {
+    size_t pushed = ring.PushMany(samples, count);
+    if (pushed < count) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        overrun_samples.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+}
+
+// Hilo de audio de SDL. Si el ring no alcanza se repite la ultima muestra (sin click).
+void AudioOutput::Callback(void* userdata, Uint8* stream, int len) {
+    AudioOutput* self = (AudioOutput*)userdata;
+    float* out = (float*)stream;
+    size_t count = len / sizeof(float);
+
+    size_t got = self->ring.PopMany(out, count);
+    if (got > 0) self->last_sample = out[got - 1];
+    if (got < count) {
+        std::fill(out + got, out + count, self->last_sample);
+        self->underruns.fetch_add(1, std::memory_order_relaxed);
+        self->underrun_samples.fetch_add(count - got, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "CPU.hpp"
+#include "SpscQueue.hpp"
+#include <SDL2/SDL.h>
+#include <atomic>
+
+namespace CPU {
+    // Salida de audio por callback. El hilo de emulacion (APU::Tick) escribe en un ring
+    // lock-free y el callback de SDL lee de ahi: ninguno de los dos toma locks ni reserva
+    // memoria. El que marca el ritmo pregunta NeedsAudio() en vez de mirar la cola de SDL.
+    class AudioOutput {
+        public:
+        static const size_t RING_SAMPLES = 16384;   // ~340 ms a 48 kHz
+
+        private:
+        SDL_AudioDeviceID device = 0;
+        int sample_rate = 44100;
+        size_t target = 0;          // Muestras en el ring que apuntamos a tener
+        SpscQueue<float, RING_SAMPLES> ring;
+        float last_sample = 0.0f;   // Solo el callback
+
+        std::atomic<u64> underruns{0};          // Callbacks que no encontraron suficiente
+        std::atomic<u64> underrun_samples{0};
+        std::atomic<u64> overruns{0};           // Pushes que no entraron enteros
+        std::atomic<u64> overrun_samples{0};
+
+        static void Callback(void* userdata, Uint8* stream, int len);
+
+        public:
+        ~AudioOutput() { Close(); }
+
+        // latency_ms: lo que se deja acumulado en el ring (mas el buffer propio de SDL)
+        bool Open(int sample_rate, int latency_ms);
+        void Close();
+        bool IsOpen() const { return device != 0; }
+        int SampleRate() const { return sample_rate; }
+
+        // Productor: lo que no entra se descarta y cuenta como overrun
+        void Push(const float* samples, size_t count);
+
+        // Cualquier hilo
+        size_t Fill() const { return ring.Size(); }
+        double FillMilliseconds() const { return Fill() * 1000.0 / sample_rate; }
+        size_t TargetSamples() const { return target; }
+        bool NeedsAudio() const { return Fill() < target; }
+        u64 Underruns() const { return underruns.load(std::memory_order_relaxed); }
+        u64 UnderrunSamples() const { return underrun_samples.load(std::memory_order_relaxed); }
+        u64 Overruns() const { return overruns.load(std::memory_order_relaxed); }
+        u64 OverrunSamples() const { return overrun_samples.load(std::memory_order_relaxed); }
+    };
+}
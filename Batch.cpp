@@ -0,0 +1,359 @@
+#include "Batch.hpp"
+#include "Capture.hpp"
+#ifdef EMU_PROFILER
+#include "Profiler.hpp"
+#endif
+#ifdef EMU_BUS_STATS
+#include "BusStats.hpp"
+#endif
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace CPU;
+
+namespace CPU {
+    // Cola por worker: el duenio saca del final, los ladrones roban del principio
+    class WorkQueue {
+        private:
+        std::deque<int> jobs;
+        std::mutex lock;
+
+        public:
+        void Push(int job) {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(job);
+        }
+        bool PopBack(int& job) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (jobs.empty()) return false;
+            job = jobs.back();
+            jobs.pop_back();
+            return true;
+        }
+        bool StealFront(int& job) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (jobs.empty()) return false;
+            job = jobs.front();
+            jobs.pop_front();
+            return true;
+        }
+    };
+
+    struct InputEvent {
+        int frame;
+        u8 mask;
+    };
+}
+
+static u64 HashBytes(const void* data, size_t size, u64 hash = 1469598103934665603ull) {
+    const u8* bytes = (const u8*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::shared_ptr<const std::vector<u8>> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+    auto data = std::make_shared<std::vector<u8>>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data->empty()) return nullptr;
+    return data;
+}
+
+// Movie: lineas "<frame> <mascara hex>", la mascara vale desde ese frame en adelante
+static bool LoadInput(const std::string& path, std::vector<InputEvent>& events) {
+    events.clear();
+    if (path.empty() || path == "-") return true;
+
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        int frame;
+        unsigned mask;
+        if (fields >> frame >> std::hex >> mask) events.push_back({frame, (u8)mask});
+    }
+    return true;
+}
+
+static void WriteScreenshot(const std::string& path, const u8* frame) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return;
+
+    u8 gray[160 * 144];
+    ExpandFrame(frame, gray, 160, PIXEL_GRAY8, PALETTE_GRAY);
+    file << "P6\n160 144\n255\n";
+    for (u8 v : gray) {
+        u8 rgb[3] = {v, v, v};
+        file.write((const char*)rgb, 3);
+    }
+}
+
+bool CPU::LoadManifest(const char* path, std::vector<BatchJob>& jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.rom_path >> job.input_path >> job.frames)) continue;
+        if (!(fields >> job.output) || job.output == "-") job.output.clear();
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+BatchSummary CPU::RunBatch(const std::vector<BatchJob>& jobs, int threads, std::vector<BatchResult>& results) {
+    BatchSummary summary;
+    summary.threads = threads;
+    summary.jobs_per_worker.assign(threads, 0);
+    summary.steals_per_worker.assign(threads, 0);
+    summary.frames_per_worker.assign(threads, 0);
+    results.assign(jobs.size(), BatchResult());
+
+    // Una maquina recien encendida por ROM; los workers se resetean contra ella.
+    // Se arman antes de lanzar los hilos y despues solo se leen.
+    std::map<std::string, int> rom_index;
+    std::vector<std::unique_ptr<GameBoy>> templates;
+    std::vector<int> job_template(jobs.size(), -1);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto it = rom_index.find(jobs[i].rom_path);
+        if (it == rom_index.end()) {
+            auto data = ReadFile(jobs[i].rom_path);
+            int index = -1;
+            if (data) {
+                auto tmpl = std::make_unique<GameBoy>();
+                tmpl->Init();
+                tmpl->SetROM(data);
+                index = (int)templates.size();
+                templates.push_back(std::move(tmpl));
+            } else {
+                std::cout << " [ERROR] No se pudo leer la ROM: " << jobs[i].rom_path << std::endl;
+            }
+            it = rom_index.emplace(jobs[i].rom_path, index).first;
+        }
+        job_template[i] = it->second;
+    }
+
+    std::vector<WorkQueue> queues(threads);
+    for (size_t i = 0; i < jobs.size(); i++) queues[i % threads].Push((int)i);
+
+    auto worker = [&](int id) {
+        auto gb = std::make_unique<GameBoy>();
+        std::vector<InputEvent> events;
+        CaptureWriter capture;
+        std::vector<float> samples;
+        samples.reserve(4096);
+#ifdef EMU_PROFILER
+        std::unique_ptr<Profiler> profiler;
+#endif
+#ifdef EMU_BUS_STATS
+        std::unique_ptr<BusStats> bus_stats;
+#endif
+
+        while (true) {
+            int job_id;
+            if (!queues[id].PopBack(job_id)) {
+                bool stolen = false;
+                for (int k = 1; k < threads && !stolen; k++) {
+                    stolen = queues[(id + k) % threads].StealFront(job_id);
+                }
+                if (!stolen) break;
+                summary.steals_per_worker[id]++;
+            }
+
+            const BatchJob& job = jobs[job_id];
+            BatchResult& result = results[job_id];
+            result.worker = id;
+            summary.jobs_per_worker[id]++;
+
+            if (job_template[job_id] < 0 || !LoadInput(job.input_path, events)) continue;
+
+            auto start = std::chrono::steady_clock::now();
+            gb->ResetTo(*templates[job_template[job_id]]);
+
+            // Sin tiempo real que cuidar: si el writer se atrasa, Submit espera
+            bool recording = job.capture && !job.output.empty() && capture.Open(job.output + ".gbv", false);
+            gb->audio_capture = recording ? &samples : nullptr;
+            samples.clear();
+#ifdef EMU_PROFILER
+            // Simbolos: el .sym de RGBDS junto a la ROM, con el mismo nombre
+            bool profiling = job.profile && !job.output.empty();
+            if (profiling) {
+                if (!profiler) profiler = std::make_unique<Profiler>();
+                else profiler->Reset();
+                profiler->LoadSymbols(job.rom_path.substr(0, job.rom_path.rfind('.')) + ".sym");
+            }
+            gb->cpu.SetProfiler(profiling ? profiler.get() : nullptr);
+#endif
+#ifdef EMU_BUS_STATS
+            bool counting = job.bus_stats && !job.output.empty();
+            if (counting) {
+                if (!bus_stats) bus_stats = std::make_unique<BusStats>();
+                else bus_stats->Reset();
+            }
+            gb->cpu.bus.SetStats(counting ? bus_stats.get() : nullptr);
+#endif
+
+            size_t next_event = 0;
+            u64 trace = 1469598103934665603ull;
+            result.ok = true;
+            for (int frame = 0; frame < job.frames; frame++) {
+                while (next_event < events.size() && events[next_event].frame <= frame) {
+                    gb->SetJoypad(events[next_event].mask);
+                    next_event++;
+                }
+                if (!gb->RunFrame()) {
+                    result.ok = false;
+                    break;
+                }
+                trace = HashBytes(gb->ppu.GetFrame(), 160 * 144, trace);
+                if (recording) {
+                    capture.Submit(gb->ppu.GetFrame(), gb->ppu.FrameSerial(), samples);
+                    samples.clear();
+                }
+                result.frames_run++;
+            }
+            if (recording) capture.Close();
+#ifdef EMU_PROFILER
+            if (profiling) {
+                gb->cpu.SetProfiler(nullptr);
+                profiler->WriteReports(job.output);
+            }
+#endif
+#ifdef EMU_BUS_STATS
+            if (counting) {
+                gb->cpu.bus.SetStats(nullptr);
+                bus_stats->WriteReports(job.output);
+            }
+#endif
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.frame_hash = HashBytes(gb->ppu.GetFrame(), 160 * 144);
+            result.trace_hash = trace;
+
+            if (!job.output.empty()) WriteScreenshot(job.output + ".ppm", gb->ppu.GetFrame());
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) pool.emplace_back(worker, i);
+    for (auto& t : pool) t.join();
+    summary.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const BatchResult& r : results) {
+        summary.frames += r.frames_run;
+        if (r.worker >= 0) summary.frames_per_worker[r.worker] += r.frames_run;
+    }
+    return summary;
+}
+
+static void PrintSummary(const BatchSummary& s) {
+    double fps = s.wall_seconds > 0 ? s.frames / s.wall_seconds : 0.0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Threads: " << s.threads << " | Frames: " << s.frames
+              << " | Wall: " << s.wall_seconds << " s | " << fps << " frames/s" << std::endl;
+    for (int i = 0; i < s.threads; i++) {
+        std::cout << "  worker " << i << ": " << s.jobs_per_worker[i] << " jobs, "
+                  << s.steals_per_worker[i] << " robados, " << s.frames_per_worker[i] << " frames" << std::endl;
+    }
+}
+
+int CPU::RunBatchCommand(int argc, char* argv[]) {
+    const char* manifest = nullptr;
+    std::string results_path;
+    int threads = (int)std::thread::hardware_concurrency();
+    bool scaling = false;
+    bool capture = false;
+    bool profile = false;
+    bool bus_stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) manifest = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--results" && i + 1 < argc) results_path = argv[++i];
+        else if (arg == "--scaling") scaling = true;
+        else if (arg == "--capture") capture = true;
+        else if (arg == "--profile") profile = true;
+        else if (arg == "--bus-stats") bus_stats = true;
+    }
+    if (threads < 1) threads = 1;
+
+    std::vector<BatchJob> jobs;
+    if (!manifest || !LoadManifest(manifest, jobs)) {
+        std::cout << "ERROR: No se pudo leer el manifest." << std::endl;
+        return -1;
+    }
+    if (results_path.empty()) results_path = std::string(manifest) + ".results.csv";
+#ifndef EMU_PROFILER
+    if (profile) {
+        std::cout << "ERROR: --profile requiere compilar con -DEMU_PROFILER." << std::endl;
+        return -1;
+    }
+#endif
+#ifndef EMU_BUS_STATS
+    if (bus_stats) {
+        std::cout << "ERROR: --bus-stats requiere compilar con -DEMU_BUS_STATS." << std::endl;
+        return -1;
+    }
+#endif
+    for (BatchJob& job : jobs) {
+        job.capture = capture;
+        job.profile = profile;
+        job.bus_stats = bus_stats;
+    }
+
+    std::vector<BatchResult> results;
+    BatchSummary summary;
+
+    // Reporte de escalado: mismo manifest con 1, 2, 4... hilos.
+    // Con escalado lineal speedup_vs_1 == threads. La ultima pasada (con 'threads') es
+    // la que queda en los resultados.
+    if (scaling) {
+        double base_fps = 0.0;
+        std::cout << "threads,frames_per_s,speedup_vs_1,eficiencia" << std::endl;
+        for (int n = 1; ; n = std::min(n * 2, threads)) {
+            summary = RunBatch(jobs, n, results);
+            double fps = summary.wall_seconds > 0 ? summary.frames / summary.wall_seconds : 0.0;
+            if (n == 1) base_fps = fps;
+            double speedup = base_fps > 0 ? fps / base_fps : 0.0;
+            std::cout << n << "," << fps << "," << speedup << "," << speedup / n << std::endl;
+            if (n == threads) break;
+        }
+    } else {
+        summary = RunBatch(jobs, threads, results);
+    }
+
+    std::ofstream csv(results_path);
+    csv << "rom,input,frames,ok,seconds,frames_per_s,frame_hash,trace_hash,worker\n";
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const BatchResult& r = results[i];
+        if (!r.ok) failed++;
+        csv << jobs[i].rom_path << "," << jobs[i].input_path << "," << r.frames_run << ","
+            << (r.ok ? 1 : 0) << "," << r.seconds << ","
+            << (r.seconds > 0 ? r.frames_run / r.seconds : 0.0) << ","
+            << std::hex << std::setw(16) << std::setfill('0') << r.frame_hash << ","
+            << std::setw(16) << r.trace_hash << std::dec << std::setfill(' ') << ","
+            << r.worker << "\n";
+    }
+
+    PrintSummary(summary);
+    std::cout << "Resultados: " << results_path << " (" << failed << " jobs fallidos)" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
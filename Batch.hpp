@@ -0,0 +1,41 @@
+#pragma once
+#include "GameBoy.hpp"
+#include <string>
+#include <vector>
+
+namespace CPU {
+    // Una linea del manifest: <rom> <input|-> <frames> <salida|->
+    struct BatchJob {
+        std::string rom_path;
+        std::string input_path;
+        int frames = 0;
+        std::string output;
+        bool capture = false;   // Graba <salida>.gbv + <salida>.wav
+        bool profile = false;   // <salida>.profile.txt + <salida>.folded (requiere EMU_PROFILER)
+        bool bus_stats = false; // <salida>.bus.csv/.txt/.ppm (requiere EMU_BUS_STATS)
+    };
+
+    struct BatchResult {
+        bool ok = false;
+        int frames_run = 0;
+        double seconds = 0.0;
+        u64 frame_hash = 0;     // Hash del ultimo frame
+        u64 trace_hash = 0;     // Hash encadenado de todos los frames
+        int worker = -1;
+    };
+
+    struct BatchSummary {
+        int threads = 0;
+        double wall_seconds = 0.0;
+        long long frames = 0;
+        std::vector<int> jobs_per_worker;
+        std::vector<int> steals_per_worker;
+        std::vector<long long> frames_per_worker;
+    };
+
+    bool LoadManifest(const char* path, std::vector<BatchJob>& jobs);
+    BatchSummary RunBatch(const std::vector<BatchJob>& jobs, int threads, std::vector<BatchResult>& results);
+
+    // --batch <manifest> [--threads N] [--scaling] [--results archivo.csv] [--capture] [--profile] [--bus-stats]
+    int RunBatchCommand(int argc, char* argv[]);
+}
@@ -0,0 +1,342 @@
+#include "Bench.hpp"
+#include "Filters.hpp"
+#include "Capture.hpp"
+#include "APU.hpp"
+#include "FramePipeline.hpp"
+#include <SDL2/SDL.h>
+#include <cstring>
+#include <cstdio>
+#include "GameBoy.hpp"
+#include "RenderThread.hpp"
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace CPU;
+
+// Contenido fijo (xorshift) para que las corridas sean comparables entre versiones
+static void FillSynthetic(Memory_Bus& bus) {
+    u32 seed = 0x2545F491;
+    auto next = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (u8)seed;
+    };
+
+    for (u16 addr = 0x8000; addr < 0xA000; addr++) bus.Write(addr, next());
+
+    // 40 sprites repartidos por la pantalla, algunos con flip y OBP1
+    for (int sprite = 0; sprite < 40; sprite++) {
+        bus.Write(0xFE00 + sprite * 4, 16 + (sprite * 37) % 144);
+        bus.Write(0xFE00 + sprite * 4 + 1, 8 + (sprite * 53) % 160);
+        bus.Write(0xFE00 + sprite * 4 + 2, next());
+        bus.Write(0xFE00 + sprite * 4 + 3, next() & 0x70);
+    }
+
+    bus.Write(0xFF40, 0x93);    // LCD, BG, sprites 8x8, tiles en 0x8000
+    bus.Write(0xFF47, 0xE4);
+    bus.Write(0xFF48, 0xD2);
+    bus.Write(0xFF49, 0x1B);
+}
+
+static double BenchScanlines(PPU& ppu, Memory_Bus& bus, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        // Scroll distinto en cada frame para pasar por todos los offsets finos
+        bus.Write(0xFF42, (u8)(i * 3));
+        bus.Write(0xFF43, (u8)(i * 5));
+        for (int line = 0; line < 144; line++) ppu.RenderScanline(bus, (u8)line);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (iterations * 144.0);
+}
+
+static u64 HashFrame(const u8* frame) {
+    u64 hash = 1469598103934665603ull;
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        hash ^= frame[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Render inline contra render thread sobre una ROM real: frames/s de cada modo
+// y comparacion frame por frame (con Flush despues de cada frame)
+static void BenchRenderThread(const char* rom, int frames) {
+    auto reference = std::make_unique<GameBoy>();
+    reference->Init();
+    if (!reference->LoadROM(rom)) {
+        std::cout << "render_thread: no se pudo cargar la ROM" << std::endl;
+        return;
+    }
+    auto start_state = std::make_unique<GameBoy>(*reference);
+
+    std::vector<u64> hashes;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames && reference->RunFrame(); f++) hashes.push_back(HashFrame(reference->ppu.GetFrame()));
+    double inline_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    RenderThread worker;
+    auto threaded = std::make_unique<GameBoy>(*start_state);
+    threaded->SetRenderThread(&worker);
+    start = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < hashes.size(); f++) threaded->RunFrame();
+    worker.Flush();
+    double threaded_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    threaded->CloneFrom(*start_state);
+    std::vector<u8> frame(SCREEN_WIDTH * SCREEN_HEIGHT);
+    size_t matching = 0;
+    for (size_t f = 0; f < hashes.size(); f++) {
+        threaded->RunFrame();
+        worker.Flush();
+        worker.CopyFrame(frame.data());
+        if (HashFrame(frame.data()) == hashes[f]) matching++;
+    }
+    threaded->SetRenderThread(nullptr);
+
+    std::cout << "render_thread: inline " << hashes.size() / inline_seconds << " frames/s | worker "
+              << hashes.size() / threaded_seconds << " frames/s (" << worker.queue_stalls << " esperas de cola)" << std::endl;
+    std::cout << "render_thread: frames iguales al inline " << matching << "/" << hashes.size() << std::endl;
+}
+
+// Grabacion sin esperas de tiempo real: frames/s de punta a punta (Submit + Close) con
+// un frame nuevo cada dos y ~740 muestras por frame. Los archivos se borran al terminar.
+static void BenchCapture(const std::vector<u8>& base, int frames) {
+    static const char* paths[] = {"bench_capture.gbv", "bench_capture.y4m"};
+    std::vector<u8> frame(base);
+    std::vector<float> samples(740, 0.25f);
+
+    for (const char* path : paths) {
+        CaptureWriter writer;
+        if (!writer.Open(path, false)) {
+            std::cout << "capture: no se pudo abrir " << path << std::endl;
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            if (f % 2 == 0) frame[(f * 131) % frame.size()] ^= 1;
+            writer.Submit(frame.data(), (u32)(f / 2), samples);
+        }
+        CaptureStats stats = writer.Close();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double fps = frames / seconds;
+        std::cout << "capture." << (path + 14) << ": " << fps << " frames/s (" << fps / 59.73 << "x tiempo real, "
+                  << stats.bytes / 1024 << " KB)" << std::endl;
+
+        std::remove(path);
+        std::remove("bench_capture.wav");
+    }
+}
+
+// Musica sintetica: instrucciones de 4-24 clocks y, cada ~1/8 de frame, notas nuevas en
+// los cuatro canales, cambios de mezcla y alguna lectura de NR52 (que obliga a sincronizar).
+// Se corre paso a paso y por frame con la misma secuencia y se comparan las muestras.
+static double RunApuScript(APU& apu, int frames, std::vector<float>& out) {
+    u32 seed = 0x1234567;
+    auto next = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+
+    apu.WriteRegister(0xFF26, 0x80);
+    apu.WriteRegister(0xFF24, 0x77);
+    apu.WriteRegister(0xFF25, 0xFF);
+    for (u16 addr = 0xFF30; addr < 0xFF40; addr++) apu.WriteRegister(addr, (u8)next());
+
+    u8 status = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        int clocks = 0, next_event = 0;
+        while (clocks < 70224) {
+            if (clocks >= next_event) {
+                next_event += 8192 + next() % 2048;
+                u32 r = next();
+                u16 square_freq = 1024 + r % 1000;
+                apu.WriteRegister(0xFF11, (u8)(r << 6) | 0x10);
+                apu.WriteRegister(0xFF12, 0xF3);
+                apu.WriteRegister(0xFF13, (u8)square_freq);
+                apu.WriteRegister(0xFF14, 0x80 | (square_freq >> 8));
+                apu.WriteRegister(0xFF17, 0xA1 | (r & 0x08));
+                apu.WriteRegister(0xFF18, (u8)(square_freq * 3 / 2));
+                apu.WriteRegister(0xFF19, 0xC0 | ((square_freq * 3 / 2) >> 8 & 0x07));
+                apu.WriteRegister(0xFF1A, 0x80);
+                apu.WriteRegister(0xFF1C, 0x20 + (r & 0x40));
+                apu.WriteRegister(0xFF1D, (u8)(r >> 8));
+                apu.WriteRegister(0xFF1E, 0x86);
+                apu.WriteRegister(0xFF21, 0x81 + (r & 0x30));
+                apu.WriteRegister(0xFF22, (u8)(r >> 16) & 0x7F);
+                apu.WriteRegister(0xFF23, 0x80);
+                if (r & 0x100) apu.WriteRegister(0xFF25, (u8)(r >> 24) | 0x11);
+                if (r & 0x200) status ^= apu.ReadRegister(0xFF26);
+            }
+            int cycles = 4 + (next() % 6) * 4;
+            apu.Tick(cycles, nullptr, &out);
+            clocks += cycles;
+        }
+        apu.EndFrame(nullptr, &out);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (status == 0xFF) std::cout << "";     // Que la lectura no se optimice
+    return seconds;
+}
+
+static void BenchApu(int frames) {
+    std::vector<float> stepped, batched;
+    stepped.reserve(frames * 800);
+    batched.reserve(frames * 800);
+
+    auto step_apu = std::make_unique<APU>();
+    step_apu->SetBatched(false);
+    double step_seconds = RunApuScript(*step_apu, frames, stepped);
+
+    auto frame_apu = std::make_unique<APU>();
+    double frame_seconds = RunApuScript(*frame_apu, frames, batched);
+
+    bool same = stepped.size() == batched.size() &&
+                std::memcmp(stepped.data(), batched.data(), stepped.size() * sizeof(float)) == 0;
+    std::cout << "apu.por_paso: " << step_seconds * 1e6 / frames << " us/frame" << std::endl;
+    std::cout << "apu.por_frame: " << frame_seconds * 1e6 / frames << " us/frame ("
+              << stepped.size() << " muestras, " << (same ? "iguales" : "DISTINTAS") << ")" << std::endl;
+}
+
+// Ruido sonando todo el tiempo: NR43 = 0x00 (un paso del LFSR cada 8 clocks) contra 0x70
+// (cada 8192). Con los pasos agrupados por muestra los dos tienen que costar parecido.
+static void BenchNoise(int frames) {
+    static const u8 settings[2] = {0x00, 0x70};
+    static const char* names[2] = {"agudo", "grave"};
+    std::vector<float> out;
+    out.reserve(frames * 800);
+
+    for (int n = 0; n < 2; n++) {
+        auto apu = std::make_unique<APU>();
+        apu->WriteRegister(0xFF26, 0x80);
+        apu->WriteRegister(0xFF24, 0x77);
+        apu->WriteRegister(0xFF25, 0x88);
+        apu->WriteRegister(0xFF21, 0xF0);
+        apu->WriteRegister(0xFF22, settings[n]);
+        apu->WriteRegister(0xFF23, 0x80);
+
+        out.clear();
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            apu->Tick(70224, nullptr, &out);
+            apu->EndFrame(nullptr, &out);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "apu.ruido_" << names[n] << ": " << seconds * 1e6 / frames << " us/frame" << std::endl;
+    }
+}
+
+// Presentacion de un frame con la ventana oculta: el camino viejo (un rect por pixel) contra
+// la textura streaming que usa Main (expansion, subida y un solo RenderCopy)
+static void BenchPresent(const std::vector<u8>& frame, int iterations) {
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cout << "present: sin video (" << SDL_GetError() << ")" << std::endl;
+        return;
+    }
+    SDL_Window* window = SDL_CreateWindow("bench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          SCREEN_WIDTH * 3, SCREEN_HEIGHT * 3, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED) : nullptr;
+    if (!renderer) {
+        std::cout << "present: sin renderer (" << SDL_GetError() << ")" << std::endl;
+        if (window) SDL_DestroyWindow(window);
+        SDL_Quit();
+        return;
+    }
+    SDL_RenderSetLogicalSize(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    static const u8 SHADES[4] = {255, 170, 85, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                u8 shade = SHADES[frame[y * SCREEN_WIDTH + x]];
+                SDL_SetRenderDrawColor(renderer, shade, shade, shade, 255);
+                SDL_Rect rect = {x, y, 1, 1};
+                SDL_RenderFillRect(renderer, &rect);
+            }
+        }
+        SDL_RenderPresent(renderer);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "present.rects: " << seconds * 1e6 / iterations << " us/frame" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        SDL_RenderClear(renderer);
+        DrawIndexedFrame(renderer, texture, frame.data(), PALETTE_GREEN);
+        SDL_RenderPresent(renderer);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "present.texture: " << seconds * 1e6 / iterations << " us/frame" << std::endl;
+
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
+
+int CPU::RunBenchCommand(int argc, char* argv[]) {
+    int iterations = 2000;
+    const char* rom = nullptr;
+    int frames = 600;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rom" && i + 1 < argc) rom = argv[++i];
+        else if (arg == "--frames" && i + 1 < argc) frames = std::max(1, std::atoi(argv[++i]));
+    }
+
+    auto bus = std::make_unique<Memory_Bus>();
+    auto ppu = std::make_unique<PPU>();
+    FillSynthetic(*bus);
+
+    // Calentamiento: caches y frecuencia del CPU
+    BenchScanlines(*ppu, *bus, iterations / 10 + 1);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "ppu.scanline: " << BenchScanlines(*ppu, *bus, iterations) << " ns/linea ("
+              << iterations << " frames)" << std::endl;
+
+    bus->Write(0xFF40, 0x91);   // Solo fondo
+    std::cout << "ppu.scanline_bg: " << BenchScanlines(*ppu, *bus, iterations) << " ns/linea" << std::endl;
+
+    // Expansion del frame indexado a cada formato de salida
+    static const char* names[] = {"argb8888", "rgb565", "gray8"};
+    std::vector<u8> frame(SCREEN_WIDTH * SCREEN_HEIGHT), out(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    for (size_t i = 0; i < frame.size(); i++) frame[i] = (i * 7 + i / SCREEN_WIDTH) & 0x03;
+    for (int format = PIXEL_ARGB8888; format <= PIXEL_GRAY8; format++) {
+        int pitch = SCREEN_WIDTH * BytesPerPixel((PixelFormat)format);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) ExpandFrame(frame.data(), out.data(), pitch, (PixelFormat)format, PALETTE_GREEN);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "video.expand_" << names[format] << ": " << seconds * 1e6 / iterations << " us/frame" << std::endl;
+    }
+
+    // Filtros de escalado (nearest a 3x), mismo frame sintetico
+    for (int type = 0; type < FILTER_COUNT; type++) {
+        FrameFilter filter((FilterType)type, 3, PALETTE_GREEN);
+        std::vector<u32> scaled(filter.Width() * filter.Height());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) filter.Apply(frame.data(), scaled.data(), filter.Width());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "filter." << GetFilterInfo((FilterType)type).name << ": " << seconds * 1e6 / iterations
+                  << " us/frame (" << filter.Width() << "x" << filter.Height() << ")" << std::endl;
+    }
+
+    BenchPresent(frame, std::max(iterations / 10, 20));
+
+    BenchCapture(frame, std::max(frames, 600));
+    BenchApu(std::max(frames, 600));
+    BenchNoise(std::max(frames, 600));
+
+    if (rom) BenchRenderThread(rom, frames);
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "PPU.hpp"
+
+namespace CPU {
+    // Microbenchmarks sin ventana: --bench [--iterations N] [--rom R] [--frames F]
+    // ppu: ns por scanline de RenderScanline sobre VRAM/OAM sinteticas
+    // video: us por frame de ExpandFrame en cada formato
+    // filter: us por frame de cada FrameFilter
+    // present: us por frame presentado en una ventana oculta, un rect por pixel contra la
+    //          textura streaming
+    // capture: frames/s que sostiene la grabacion (GBV y Y4M, con audio)
+    // apu: us por frame de sintesis paso a paso y por frame (y que den las mismas muestras),
+    //      y con ruido agudo contra grave
+    // --rom R [--frames F]: render inline contra render thread (velocidad y frames iguales)
+    int RunBenchCommand(int argc, char* argv[]);
+}
@@ -0,0 +1,107 @@
+#include "BlipBuffer.hpp"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace CPU;
+
+// Impulso band-limited para cada fase fraccional; cada fila suma 1 para que la
+// integral de un delta sea exactamente el escalon
+struct StepKernel {
+    float taps[BlipBuffer::PHASES][BlipBuffer::KERNEL_WIDTH];
+
+    StepKernel() {
+        const double PI = 3.14159265358979323846;
+        const double cutoff = 0.45;     // Ciclos por muestra (Nyquist = 0.5)
+        const double half = BlipBuffer::KERNEL_WIDTH / 2.0;
+
+        for (int phase = 0; phase < BlipBuffer::PHASES; phase++) {
+            double frac = (double)phase / BlipBuffer::PHASES;
+            double row[BlipBuffer::KERNEL_WIDTH];
+            double sum = 0.0;
+            for (int k = 0; k < BlipBuffer::KERNEL_WIDTH; k++) {
+                double x = k - (half - 1.0) - frac;
+                double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * PI * cutoff * x) / (2.0 * PI * cutoff * x);
+                double window = 0.42 + 0.5 * std::cos(PI * x / half) + 0.08 * std::cos(2.0 * PI * x / half);
+                row[k] = sinc * std::max(window, 0.0);
+                sum += row[k];
+            }
+            for (int k = 0; k < BlipBuffer::KERNEL_WIDTH; k++) taps[phase][k] = (float)(row[k] / sum);
+        }
+    }
+};
+static const StepKernel KERNEL;
+
+void BlipBuffer::SetRates(double clock_rate, double sample_rate, int max_clocks) {
+    base_factor = sample_rate / clock_rate * 4294967296.0;
+    factor = (u64)(base_factor + 0.5);
+    // Lugar para el ratio maximo de SetRatio
+    int max_samples = (int)(max_clocks * sample_rate * 1.01 / clock_rate) + 2;
+    stride = (max_samples + KERNEL_WIDTH + 4) & ~(size_t)3;
+    buffer.assign(stride * channels, 0.0f);
+    offset = 0;
+}
+
+void BlipBuffer::SetRatio(double ratio) {
+    ratio = std::max(0.99, std::min(ratio, 1.01));
+    factor = (u64)(base_factor * ratio + 0.5);
+}
+
+void BlipBuffer::AddDelta(int channel, u32 time, float delta) {
+    u64 position = offset + time * factor;
+    u32 index = (u32)(position >> 32);
+    int phase = (int)((position >> (32 - 6)) & (PHASES - 1));
+
+    if (index + KERNEL_WIDTH > stride) return;
+    float* out = &buffer[channel * stride + index];
+    const float* taps = KERNEL.taps[phase];
+    for (int k = 0; k < KERNEL_WIDTH; k++) out[k] += delta * taps[k];
+}
+
+void BlipBuffer::EndFrame(u32 clocks) {
+    offset += clocks * factor;
+}
+
+int BlipBuffer::ReadSamples(float* out, int max) {
+    int count = std::min(SamplesAvailable(), max);
+
+    // Mezcla: suma de los deltas de todos los canales, de a 4 muestras
+    const float* first = buffer.data();
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_loadu_ps(first + i);
+        for (int c = 1; c < channels; c++) sum = _mm_add_ps(sum, _mm_loadu_ps(first + c * stride + i));
+        _mm_storeu_ps(out + i, sum);
+    }
+#endif
+    for (; i < count; i++) {
+        float sum = first[i];
+        for (int c = 1; c < channels; c++) sum += first[c * stride + i];
+        out[i] = sum;
+    }
+
+    float level = integrator;
+    for (i = 0; i < count; i++) {
+        level += out[i];
+        out[i] = level;
+    }
+    integrator = level;
+
+    // Lo que queda (las colas de los kernels) pasa al principio
+    for (int c = 0; c < channels; c++) {
+        float* channel = &buffer[c * stride];
+        std::copy(channel + count, channel + stride, channel);
+        std::fill(channel + stride - count, channel + stride, 0.0f);
+    }
+    offset -= (u64)count << 32;
+    return count;
+}
+
+void BlipBuffer::Clear(float level) {
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    offset &= 0xFFFFFFFFull;
+    integrator = level;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "CPU.hpp"
+#include <vector>
+
+namespace CPU {
+    // Sintesis band-limited por deltas (estilo blip_buf). Cada canal avisa solo cuando
+    // cambia su amplitud: el salto se suma al buffer como un impulso filtrado (sinc con
+    // ventana de Blackman, fase fraccional de 1/64 de muestra) y las muestras salen de
+    // integrar el buffer. El costo depende de la cantidad de flancos, no de la frecuencia
+    // de muestreo, y no hay aliasing en los agudos.
+    // Cada canal tiene su propio buffer de deltas y se mezclan recien al leer: lo que queda
+    // en cada uno depende solo del orden de sus propios deltas, no de como se intercalen
+    // los canales entre si.
+    class BlipBuffer {
+        public:
+        static const int KERNEL_WIDTH = 16;     // Latencia: KERNEL_WIDTH / 2 muestras
+        static const int PHASES = 64;
+
+        private:
+        u64 factor = 0;         // Muestras por clock, punto fijo 32.32
+        double base_factor = 0.0;   // Sin ajuste de ratio
+        u64 offset = 0;         // Posicion de la muestra 0 del buffer, 32.32
+        float integrator = 0.0f;
+        int channels = 1;
+        size_t stride = 0;              // Floats por canal
+        std::vector<float> buffer;      // channels * stride
+
+        public:
+        explicit BlipBuffer(int channel_count = 1) : channels(channel_count) { SetRates(4194304, 44100, 8192); }
+
+        // max_clocks: el mayor intervalo entre dos EndFrame
+        void SetRates(double clock_rate, double sample_rate, int max_clocks);
+        // Resampleo fino: muestras por clock = sample_rate / clock_rate * ratio (0.99-1.01).
+        // No vacia el buffer.
+        void SetRatio(double ratio);
+
+        // 'time' en clocks desde el ultimo EndFrame
+        void AddDelta(int channel, u32 time, float delta);
+        void EndFrame(u32 clocks);
+        int SamplesAvailable() const { return (int)(offset >> 32); }
+        // Mezcla los canales, integra y saca las muestras disponibles (hasta 'max');
+        // devuelve cuantas
+        int ReadSamples(float* out, int max);
+
+        // Vacia el buffer dejando la salida en 'level'
+        void Clear(float level);
+    };
+}
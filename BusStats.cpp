@@ -0,0 +1,142 @@
+#include "BusStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+using namespace CPU;
+
+static const char* REGION_NAMES[BusStats::REGIONS] = {
+    "rom0", "romx", "vram", "sram", "wram", "echo", "oam", "unusable", "io", "hram", "ie"
+};
+
+const char* BusStats::RegionName(int region) {
+    return REGION_NAMES[region];
+}
+
+void BusStats::Reset() {
+    *this = BusStats();
+}
+
+void BusStats::EndFrame() {
+    frames.push_back(frame);
+    frame = FrameCounts();
+
+    if (++frames_in_row < frames_per_row) return;
+    rows.push_back(row);
+    row.fill(0);
+    frames_in_row = 0;
+    // Corrida larga: el mapa queda con la misma altura y cada fila cubre el doble de frames
+    if (rows.size() == MAX_ROWS) {
+        for (size_t i = 0; i < MAX_ROWS / 2; i++) {
+            for (int p = 0; p < 512; p++) rows[i][p] = rows[2 * i][p] + rows[2 * i + 1][p];
+        }
+        rows.resize(MAX_ROWS / 2);
+        frames_per_row *= 2;
+    }
+}
+
+void BusStats::WriteCsv(std::ostream& out) const {
+    out << "frame";
+    for (int r = 0; r < REGIONS; r++) out << "," << REGION_NAMES[r] << "_r," << REGION_NAMES[r] << "_w";
+    out << ",rom_switches,ram_switches,dmas\n";
+    for (size_t f = 0; f < frames.size(); f++) {
+        const FrameCounts& c = frames[f];
+        out << f;
+        for (int r = 0; r < REGIONS; r++) out << "," << c.reads[r] << "," << c.writes[r];
+        out << "," << c.rom_switches << "," << c.ram_switches << "," << c.dmas << "\n";
+    }
+}
+
+void BusStats::WriteSummary(std::ostream& out, size_t top_pages) const {
+    size_t count = std::max<size_t>(frames.size(), 1);
+    u64 reads[REGIONS] = {}, writes[REGIONS] = {};
+    u64 rom_switches = 0, ram_switches = 0, dmas = 0;
+    u32 max_rom_switches = 0, max_dmas = 0;
+    for (const FrameCounts& c : frames) {
+        for (int r = 0; r < REGIONS; r++) {
+            reads[r] += c.reads[r];
+            writes[r] += c.writes[r];
+        }
+        rom_switches += c.rom_switches;
+        ram_switches += c.ram_switches;
+        dmas += c.dmas;
+        max_rom_switches = std::max(max_rom_switches, c.rom_switches);
+        max_dmas = std::max(max_dmas, c.dmas);
+    }
+    u64 total = 0;
+    for (int r = 0; r < REGIONS; r++) total += reads[r] + writes[r];
+
+    out << std::fixed << std::setprecision(1);
+    out << "Frames: " << frames.size() << " | Accesos: " << total << " (" << (double)total / count << " por frame)" << std::endl;
+    out << "Cambios de banco ROM: " << rom_switches << " (" << (double)rom_switches / count << " por frame, max " << max_rom_switches
+        << ") | RAM: " << ram_switches << " | DMAs OAM: " << dmas << " (max " << max_dmas << " por frame)" << std::endl;
+
+    out << std::endl << "== Por region (lecturas, escrituras, por frame) ==" << std::endl;
+    for (int r = 0; r < REGIONS; r++) {
+        if (reads[r] + writes[r] == 0) continue;
+        out << std::setw(9) << REGION_NAMES[r] << std::setw(14) << reads[r] << std::setw(14) << writes[r]
+            << std::setw(12) << (double)reads[r] / count << std::setw(12) << (double)writes[r] / count
+            << std::setw(7) << (total ? 100.0 * (reads[r] + writes[r]) / total : 0.0) << "%" << std::endl;
+    }
+
+    out << std::endl << "== ROMX por banco (lecturas) ==" << std::endl;
+    for (int b = 0; b < 256; b++) {
+        if (rom_bank_reads[b]) out << std::setw(9) << b << std::setw(14) << rom_bank_reads[b] << std::endl;
+    }
+    out << std::endl << "== RAM externa por banco (lecturas, escrituras) ==" << std::endl;
+    for (int b = 0; b < 16; b++) {
+        if (ram_bank_reads[b] + ram_bank_writes[b]) {
+            out << std::setw(9) << b << std::setw(14) << ram_bank_reads[b] << std::setw(14) << ram_bank_writes[b] << std::endl;
+        }
+    }
+
+    out << std::endl << "== IO por registro (lecturas, escrituras) ==" << std::endl << std::hex << std::uppercase;
+    for (int i = 0; i < 0x80; i++) {
+        if (io_reads[i] + io_writes[i] == 0) continue;
+        out << "     FF" << std::setw(2) << std::setfill('0') << i << std::setfill(' ') << std::dec
+            << std::setw(14) << io_reads[i] << std::setw(14) << io_writes[i] << std::hex << std::endl;
+    }
+    out << std::dec << std::nouppercase;
+
+    std::vector<int> pages(256);
+    for (int p = 0; p < 256; p++) pages[p] = p;
+    std::sort(pages.begin(), pages.end(), [&](int a, int b) { return page_reads[a] + page_writes[a] > page_reads[b] + page_writes[b]; });
+    out << std::endl << "== Paginas mas usadas (lecturas, escrituras) ==" << std::endl;
+    for (size_t i = 0; i < top_pages && page_reads[pages[i]] + page_writes[pages[i]] > 0; i++) {
+        int p = pages[i];
+        out << "     " << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << p << "xx" << std::setfill(' ')
+            << std::dec << std::nouppercase << std::setw(5) << REGION_NAMES[RegionOf((u16)(p << 8))]
+            << std::setw(14) << page_reads[p] << std::setw(14) << page_writes[p] << std::endl;
+    }
+}
+
+void BusStats::WriteHeatmap(std::ostream& out) const {
+    std::vector<std::array<u32, 512>> all = rows;
+    if (frames_in_row > 0) all.push_back(row);
+    u32 peak = 1;
+    for (const auto& r : all) peak = std::max(peak, *std::max_element(r.begin(), r.end()));
+    double scale = 255.0 / std::log1p((double)peak);
+
+    out << "P6\n256 " << all.size() << "\n255\n";
+    std::vector<u8> line(256 * 3);
+    for (const auto& r : all) {
+        for (int p = 0; p < 256; p++) {
+            line[p * 3 + 0] = (u8)(std::log1p((double)r[256 + p]) * scale);
+            line[p * 3 + 1] = (u8)(std::log1p((double)r[p]) * scale);
+            line[p * 3 + 2] = 0;
+        }
+        out.write((const char*)line.data(), line.size());
+    }
+}
+
+bool BusStats::WriteReports(const std::string& prefix) const {
+    std::ofstream csv(prefix + ".bus.csv");
+    std::ofstream summary(prefix + ".bus.txt");
+    std::ofstream heatmap(prefix + ".bus.ppm", std::ios::binary);
+    if (!csv || !summary || !heatmap) return false;
+    WriteCsv(csv);
+    WriteSummary(summary);
+    WriteHeatmap(heatmap);
+    return csv.good() && summary.good() && heatmap.good();
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "CPU.hpp"
+#include <array>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace CPU {
+    // Estadisticas del bus. Solo se enganchan si se compila con -DEMU_BUS_STATS: sin ese
+    // flag Memory_Bus no tiene ni el puntero ni los hooks.
+    // Cuenta lecturas/escrituras de Memory_Bus::Read/Write (el CPU, incluido el fetch, y la
+    // DMA; la PPU lee VRAM/OAM directo y no pasa por aca) por region, por banco de ROM/RAM
+    // externa, por registro de IO y por pagina de 256 bytes, y los cambios de banco y DMAs.
+    // HandleInterrupts lee IF/IE por Read antes de cada instruccion: eso tambien cuenta.
+    class BusStats {
+        public:
+        enum Region { ROM0, ROMX, VRAM, SRAM, WRAM, ECHO, OAM, UNUSABLE, IO, HRAM, IE, REGIONS };
+        static const char* RegionName(int region);
+
+        static int RegionOf(u16 address) {
+            if (address < 0x4000) return ROM0;
+            if (address < 0x8000) return ROMX;
+            if (address < 0xA000) return VRAM;
+            if (address < 0xC000) return SRAM;
+            if (address < 0xE000) return WRAM;
+            if (address < 0xFE00) return ECHO;
+            if (address < 0xFEA0) return OAM;
+            if (address < 0xFF00) return UNUSABLE;
+            if (address < 0xFF80) return IO;
+            return address == 0xFFFF ? IE : HRAM;
+        }
+
+        struct FrameCounts {
+            u32 reads[REGIONS] = {};
+            u32 writes[REGIONS] = {};
+            u32 rom_switches = 0;
+            u32 ram_switches = 0;
+            u32 dmas = 0;
+        };
+
+        // Filas del mapa de calor: una por frame hasta MAX_ROWS; despues se juntan de a dos
+        static constexpr size_t MAX_ROWS = 1024;
+
+        private:
+        FrameCounts frame;
+        std::vector<FrameCounts> frames;
+
+        u64 page_reads[256] = {};
+        u64 page_writes[256] = {};
+        u64 rom_bank_reads[256] = {};
+        u64 ram_bank_reads[16] = {};
+        u64 ram_bank_writes[16] = {};
+        u64 io_reads[0x80] = {};
+        u64 io_writes[0x80] = {};
+
+        // Fila en curso: lecturas en [0, 256), escrituras en [256, 512)
+        std::array<u32, 512> row = {};
+        std::vector<std::array<u32, 512>> rows;
+        u32 frames_in_row = 0;
+        u32 frames_per_row = 1;
+
+        public:
+        void Reset();
+
+        void OnRead(u16 address, u8 rom_bank, u8 ram_bank) {
+            int region = RegionOf(address);
+            frame.reads[region]++;
+            page_reads[address >> 8]++;
+            row[address >> 8]++;
+            if (region == ROMX) rom_bank_reads[rom_bank]++;
+            else if (region == SRAM) ram_bank_reads[ram_bank & 0x0F]++;
+            else if (region == IO) io_reads[address & 0x7F]++;
+        }
+        void OnWrite(u16 address, u8 ram_bank) {
+            int region = RegionOf(address);
+            frame.writes[region]++;
+            page_writes[address >> 8]++;
+            row[256 + (address >> 8)]++;
+            if (region == SRAM) ram_bank_writes[ram_bank & 0x0F]++;
+            else if (region == IO) io_writes[address & 0x7F]++;
+        }
+        // Solo las escrituras al MBC que cambian el banco mapeado
+        void OnRomBankSwitch() { frame.rom_switches++; }
+        void OnRamBankSwitch() { frame.ram_switches++; }
+        void OnDma() { frame.dmas++; }
+
+        // Cierra el frame (GameBoy::RunFrame)
+        void EndFrame();
+        size_t Frames() const { return frames.size(); }
+
+        // Una fila por frame: lecturas/escrituras por region, cambios de banco y DMAs
+        void WriteCsv(std::ostream& out) const;
+        // Totales por region, banco, registro de IO y las paginas mas usadas
+        void WriteSummary(std::ostream& out, size_t top_pages = 32) const;
+        // PPM de 256 columnas (paginas 0x00-0xFF) por una fila por frame (o grupo de frames):
+        // verde = lecturas, rojo = escrituras, en escala logaritmica
+        void WriteHeatmap(std::ostream& out) const;
+        // <prefijo>.bus.csv, <prefijo>.bus.txt y <prefijo>.bus.ppm
+        bool WriteReports(const std::string& prefix) const;
+    };
+}
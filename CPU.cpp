@@ -1,6 +1,15 @@
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
 #include "CPU.hpp"
+#include "APU.hpp"
+#ifdef EMU_PROFILER
+#include "Profiler.hpp"
+#endif
+#ifdef EMU_BUS_STATS
+#include "BusStats.hpp"
+#endif
 
 using namespace CPU;
 
@@ -14,7 +23,10 @@ void Register::Init() {
 }
 
 Memory_Bus::Memory_Bus() {
-	rom.resize(0x8000, 0);
+	auto empty_rom = std::make_shared<std::vector<u8>>(0x8000, 0);
+	rom_data = empty_rom->data();
+	rom_size = empty_rom->size();
+	rom = std::move(empty_rom);
 	std::fill(std::begin(vram), std::end(vram), 0);
     std::fill(std::begin(wram), std::end(wram), 0);
     std::fill(std::begin(hram), std::end(hram), 0);
@@ -41,33 +53,21 @@ bool Memory_Bus::LoadROM(const char* path) {
 
 	file.seekg(0, std::ios::beg);
 
-	rom.resize(size);
+	auto data = std::make_shared<std::vector<u8>>(size);
 
-	std::cout << " [DEBUG] Vector redimensionado a: " << rom.size() << " bytes." << std::endl;
+	std::cout << " [DEBUG] Vector redimensionado a: " << data->size() << " bytes." << std::endl;
 
-	if (file.read((char*)rom.data(), size)) {
+	if (file.read((char*)data->data(), size)) {
 		std::cout << " [EXITO] ROM cargada en memoria correctamente." << std::endl;
 
-        u8 cart_type = rom[0x0147];
-        u8 ram_size_code = rom[0x0149];
-        
-        has_battery = (cart_type == 0x03 || cart_type == 0x06 || cart_type == 0x09 || cart_type == 0x0D || cart_type == 0x0F || cart_type == 0x10 || cart_type == 0x13 || cart_type == 0x1B || cart_type == 0x1E);
-
-        int ram_size = 0;
-        switch(ram_size_code) {
-            case 0x02: ram_size = 0x2000; break;  
-            case 0x03: ram_size = 0x8000; break;  
-            case 0x04: ram_size = 0x20000; break; 
-            case 0x05: ram_size = 0x10000; break; 
-        }
-        external_ram.resize(ram_size, 0);
+        SetROM(std::move(data));
 
         save_path = std::string(path);
         size_t dot_pos = save_path.find_last_of(".");
         if (dot_pos != std::string::npos) save_path = save_path.substr(0, dot_pos) + ".sav";
         else save_path += ".sav";
 
-        if (has_battery && ram_size > 0) {
+        if (has_battery && !external_ram.empty()) {
             std::ifstream sav_file(save_path, std::ios::binary);
             if (sav_file.is_open()) {
                 sav_file.read((char*)external_ram.data(), external_ram.size());
@@ -80,14 +80,40 @@ bool Memory_Bus::LoadROM(const char* path) {
 	std::cout << " [ERROR] Fallo al leer los datos con file.read()." << std::endl;
 	return false;
 }
+void Memory_Bus::SetROM(std::shared_ptr<const std::vector<u8>> data) {
+    if (data->size() < 0x8000) {
+        auto padded = std::make_shared<std::vector<u8>>(*data);
+        padded->resize(0x8000, 0xFF);
+        data = std::move(padded);
+    }
+    rom_data = data->data();
+    rom_size = data->size();
+    rom = std::move(data);
+
+    u8 cart_type = rom_data[0x0147];
+    u8 ram_size_code = rom_data[0x0149];
+    
+    has_battery = (cart_type == 0x03 || cart_type == 0x06 || cart_type == 0x09 || cart_type == 0x0D || cart_type == 0x0F || cart_type == 0x10 || cart_type == 0x13 || cart_type == 0x1B || cart_type == 0x1E);
+
+    int ram_size = 0;
+    switch(ram_size_code) {
+        case 0x02: ram_size = 0x2000; break;  
+        case 0x03: ram_size = 0x8000; break;  
+        case 0x04: ram_size = 0x20000; break; 
+        case 0x05: ram_size = 0x10000; break; 
+    }
+    external_ram.assign(ram_size, 0);
+    ext_dirty.assign((ram_size / 0x100 + 63) / 64, 0);
+}
 u8 Memory_Bus::Read(u16 address) {
+#ifdef EMU_BUS_STATS
+    if (stats) stats->OnRead(address, rom_bank, ram_bank);
+#endif
     if (address < 0x4000) {
-        if (rom.empty()) return 0xFF;
-        return rom[address];
+        return rom_data[address];
     } else if (address >= 0x4000 && address < 0x8000) {
-        if (rom.empty()) return 0xFF;
-        int offset = (rom_bank * 0x4000) + (address - 0x4000);
-        if (offset < rom.size()) return rom[offset];
+        size_t offset = (rom_bank * 0x4000) + (address - 0x4000);
+        if (offset < rom_size) return rom_data[offset];
         return 0xFF;
     } else if (address >= 0x8000 && address < 0xA000) {
         return vram[address - 0x8000];
@@ -117,6 +143,7 @@ u8 Memory_Bus::Read(u16 address) {
             
             return (selection & 0x30) | state | 0xC0; 
         }
+        if (apu && address >= 0xFF10 && address < 0xFF40) return apu->ReadRegister(address);
         return io[address - 0xFF00];
     } else if (address >= 0xFF80 && address < 0xFFFF) {
         return hram[address - 0xFF80];
@@ -127,6 +154,14 @@ u8 Memory_Bus::Read(u16 address) {
     return 0xFF;
 }
 void Memory_Bus::Write(u16 address, u8 value) {
+#ifdef EMU_BUS_STATS
+    if (stats) {
+        stats->OnWrite(address, ram_bank);
+        if (address >= 0x2000 && address < 0x4000 && rom_bank != (value ? value : 1)) stats->OnRomBankSwitch();
+        if (address >= 0x4000 && address < 0x6000 && ram_bank != (value & 0x03)) stats->OnRamBankSwitch();
+        if (address == 0xFF46) stats->OnDma();
+    }
+#endif
     if (address < 0x8000) {
         if (address < 0x2000) {
             ram_enabled = ((value & 0x0F) == 0x0A);
@@ -140,21 +175,30 @@ void Memory_Bus::Write(u16 address, u8 value) {
         
     } else if (address >= 0x8000 && address < 0xA000) {
         vram[address - 0x8000] = value;
+        vram_dirty |= 1u << ((address - 0x8000) >> 8);
+        if (address < 0x9800) tiles.Mark((address - 0x8000) >> 4);
+        if (record_video) video_writes.push_back((u32)address << 8 | value);
         
     } else if (address >= 0xA000 && address < 0xC000) {
         if (ram_enabled && !external_ram.empty()) {
             int offset = (ram_bank * 0x2000) + (address - 0xA000);
             if (offset < external_ram.size()) {
                 external_ram[offset] = value;
+                ext_dirty[offset >> 14] |= 1ull << ((offset >> 8) & 63);
             }
         }
         
     } else if (address >= 0xC000 && address < 0xE000) {
         wram[address - 0xC000] = value;
+        wram_dirty |= 1u << ((address - 0xC000) >> 8);
     } else if (address >= 0xE000 && address < 0xFE00) {
         wram[address - 0xE000] = value; 
+        wram_dirty |= 1u << ((address - 0xE000) >> 8);
     } else if (address >= 0xFE00 && address < 0xFEA0) {
-        oam[address - 0xFE00] = value;
+        u16 offset = address - 0xFE00;
+        if ((offset & 0x03) == 0) IndexSprite(offset >> 2, oam[offset], value);
+        oam[offset] = value;
+        if (record_video) video_writes.push_back((u32)address << 8 | value);
     } else if (address >= 0xFF00 && address < 0xFF80) {
         if (address == 0xFF44) return; 
         
@@ -175,12 +219,21 @@ void Memory_Bus::Write(u16 address, u8 value) {
             return;
         }
 
+        if (apu && address >= 0xFF10 && address < 0xFF40) {
+            io[address - 0xFF00] = value;
+            apu->WriteRegister(address, value);
+            return;
+        }
+
         io[address - 0xFF00] = value;
 
         if (address == 0xFF46) {
             u16 source = value << 8;
             for (int i = 0; i < 0xA0; i++) {
-                oam[i] = Read(source + i); 
+                u8 byte = Read(source + i);
+                if ((i & 0x03) == 0) IndexSprite(i >> 2, oam[i], byte);
+                oam[i] = byte; 
+                if (record_video) video_writes.push_back((u32)(0xFE00 + i) << 8 | byte);
             }
         }
     } else if (address >= 0xFF80 && address < 0xFFFF) {
@@ -189,6 +242,26 @@ void Memory_Bus::Write(u16 address, u8 value) {
         ie_register = value;
     }
 }
+void Memory_Bus::IndexSprite(int sprite, u8 old_y, u8 new_y) {
+    if (old_y == new_y) return;
+
+    // Y es la linea + 16: un sprite de alto h cubre las lineas Y-16 .. Y-16+h-1
+    u64 bit = 1ull << sprite;
+    for (int tall = 0; tall < 2; tall++) {
+        int height = tall ? 16 : 8;
+        int first = std::max(0, old_y - 16), last = std::min(144, old_y - 16 + height);
+        for (int line = first; line < last; line++) sprite_lines[tall][line] &= ~bit;
+        first = std::max(0, new_y - 16);
+        last = std::min(144, new_y - 16 + height);
+        for (int line = first; line < last; line++) sprite_lines[tall][line] |= bit;
+    }
+}
+void Memory_Bus::RebuildSpriteIndex() {
+    for (auto& lines : sprite_lines) std::fill(std::begin(lines), std::end(lines), 0);
+    // Con old_y = 0 no hay nada que borrar: Y=0 no cubre ninguna linea visible
+    for (int sprite = 0; sprite < 40; sprite++) IndexSprite(sprite, 0, oam[sprite * 4]);
+}
+
 void Memory_Bus::ShowMemory(u16 start, u16 end) {
 	for (int i = start; i <= end; i++) {
 		if (i % 16 == 0) std::cout << "\n" << std::hex << i << ": ";
@@ -197,7 +270,7 @@ void Memory_Bus::ShowMemory(u16 start, u16 end) {
 	std::cout << std::endl;
 }
 int Memory_Bus::GetRomSize() {
-	return rom.size();
+	return rom_size;
 }
 void Memory_Bus::UpdateJoypad(int key, bool pressed) {
     u8 bit = 1 << (key % 4); 
@@ -226,6 +299,137 @@ void Memory_Bus::SaveGame() {
     }
 }
 
+void Memory_Bus::RestoreFrom(const Memory_Bus& tmpl) {
+    // Otra ROM u otro tamanio de RAM externa: no hay paginas que reaprovechar
+    if (rom != tmpl.rom || external_ram.size() != tmpl.external_ram.size()) {
+#ifdef EMU_BUS_STATS
+        BusStats* own_stats = stats;
+#endif
+        *this = tmpl;
+#ifdef EMU_BUS_STATS
+        stats = own_stats;
+#endif
+        ClearDirty();
+        return;
+    }
+
+    for (u32 mask = vram_dirty; mask; mask &= mask - 1) {
+        int page = __builtin_ctz(mask);
+        std::copy_n(tmpl.vram + page * 0x100, 0x100, vram + page * 0x100);
+        // 16 tiles por pagina; las paginas 0x18-0x1F son los mapas
+        if (page < 0x18) tiles.dirty[page >> 2] |= 0xFFFFull << ((page & 3) * 16);
+    }
+    for (u32 mask = wram_dirty; mask; mask &= mask - 1) {
+        int page = __builtin_ctz(mask);
+        std::copy_n(tmpl.wram + page * 0x100, 0x100, wram + page * 0x100);
+    }
+    for (size_t word = 0; word < ext_dirty.size(); word++) {
+        for (u64 mask = ext_dirty[word]; mask; mask &= mask - 1) {
+            size_t offset = (word * 64 + __builtin_ctzll(mask)) * 0x100;
+            if (offset >= external_ram.size()) break;
+            std::copy_n(tmpl.external_ram.data() + offset, 0x100, external_ram.data() + offset);
+        }
+    }
+
+    // Regiones chicas: siempre se copian enteras
+    std::copy(std::begin(tmpl.hram), std::end(tmpl.hram), std::begin(hram));
+    std::copy(std::begin(tmpl.io), std::end(tmpl.io), std::begin(io));
+    std::copy(std::begin(tmpl.oam), std::end(tmpl.oam), std::begin(oam));
+    std::copy(&tmpl.sprite_lines[0][0], &tmpl.sprite_lines[0][0] + 2 * 144, &sprite_lines[0][0]);
+    ie_register = tmpl.ie_register;
+    div_counter = tmpl.div_counter;
+    tima_counter = tmpl.tima_counter;
+    joypad_dir = tmpl.joypad_dir;
+    joypad_action = tmpl.joypad_action;
+    ram_enabled = tmpl.ram_enabled;
+    rom_bank = tmpl.rom_bank;
+    ram_bank = tmpl.ram_bank;
+
+    ClearDirty();
+}
+// Tabla de decodificacion 2bpp: un byte de bitplane -> 8 pixeles de 1 bit, un byte por
+// pixel, pixel 0 (bit 7) en el byte mas bajo. Una fila de tile es spread[b1] | spread[b2] << 1.
+struct TileRowTable {
+    u64 spread[256];
+
+    constexpr TileRowTable() : spread() {
+        for (int b = 0; b < 256; b++) {
+            u64 v = 0;
+            for (int px = 0; px < 8; px++) {
+                if (b & (0x80 >> px)) v |= 1ull << (px * 8);
+            }
+            spread[b] = v;
+        }
+    }
+};
+static constexpr TileRowTable TILE_ROWS;
+
+void TileCache::Decode(const u8* vram, int tile) {
+    const u8* data = vram + tile * 16;
+    for (int y = 0; y < 8; y++) {
+        u64 row = TILE_ROWS.spread[data[y * 2]] | (TILE_ROWS.spread[data[y * 2 + 1]] << 1);
+        u64 flipped = __builtin_bswap64(row);
+        std::memcpy(pixels[0][tile] + y * 8, &row, 8);
+        std::memcpy(pixels[1][tile] + y * 8, &flipped, 8);
+    }
+    dirty[tile >> 6] &= ~(1ull << (tile & 63));
+    generation[tile]++;
+}
+
+void Memory_Bus::ClearDirty() {
+    vram_dirty = 0;
+    wram_dirty = 0;
+    std::fill(ext_dirty.begin(), ext_dirty.end(), 0);
+}
+
+void Memory_Bus::SaveState(StateWriter& state) const {
+    state.Put(rom_size);
+    state.Bytes(vram, sizeof(vram));
+    state.Bytes(wram, sizeof(wram));
+    state.Bytes(hram, sizeof(hram));
+    state.Bytes(io, sizeof(io));
+    state.Bytes(oam, sizeof(oam));
+    state.Put(ie_register);
+    state.Put(div_counter);
+    state.Put(tima_counter);
+    state.Put(joypad_dir);
+    state.Put(joypad_action);
+    state.Put(ram_enabled);
+    state.Put(rom_bank);
+    state.Put(ram_bank);
+    state.Put(external_ram.size());
+    state.Bytes(external_ram.data(), external_ram.size());
+}
+void Memory_Bus::LoadState(StateReader& state) {
+    size_t saved_rom_size = 0, ext_size = 0;
+    state.Get(saved_rom_size);
+    if (saved_rom_size != rom_size) { state.ok = false; return; }
+
+    state.Bytes(vram, sizeof(vram));
+    state.Bytes(wram, sizeof(wram));
+    state.Bytes(hram, sizeof(hram));
+    state.Bytes(io, sizeof(io));
+    state.Bytes(oam, sizeof(oam));
+    state.Get(ie_register);
+    state.Get(div_counter);
+    state.Get(tima_counter);
+    state.Get(joypad_dir);
+    state.Get(joypad_action);
+    state.Get(ram_enabled);
+    state.Get(rom_bank);
+    state.Get(ram_bank);
+    state.Get(ext_size);
+    if (ext_size != external_ram.size()) { state.ok = false; return; }
+    state.Bytes(external_ram.data(), external_ram.size());
+
+    // Todo pudo cambiar: el proximo RestoreFrom tiene que recopiar todas las paginas
+    vram_dirty = ~0u;
+    wram_dirty = ~0u;
+    std::fill(ext_dirty.begin(), ext_dirty.end(), ~0ull);
+    tiles.MarkAll();
+    RebuildSpriteIndex();
+}
+
 void Command::NOP() { }
 
 void Command::LD(u8& dest, u8 src) {
@@ -551,6 +755,13 @@ void Processor::Init() {
     bus.Write(0xFF43, 0x00); // SCX: Scroll X
     bus.Write(0xFF47, 0xFC); // BGP: Paleta de colores del fondo (11 11 11 00)
 	bus.Write(0xFF44, 0x90);
+	// Sonido como lo deja el boot ROM: APU prendido, todos los canales a los dos lados
+	bus.Write(0xFF26, 0x80);
+	bus.Write(0xFF24, 0x77);
+	bus.Write(0xFF25, 0xF3);
+	bus.Write(0xFF10, 0x80);
+	bus.Write(0xFF11, 0xBF);
+	bus.Write(0xFF12, 0xF3);
 	halted = false;
 }
 
@@ -562,6 +773,9 @@ u8 Processor::Step() {
             halted = false;
         } else {
 			bus.TickTimer(1);
+#ifdef EMU_PROFILER
+			if (profiler) profiler->OnHalt(1);
+#endif
             return 1;
         }
     }
@@ -617,7 +831,16 @@ u8 Processor::Step() {
 	// 		  << " | IME:" << IME
 	// 		  << std::endl;
 
+#ifdef EMU_PROFILER
+	u16 old_sp = reg.val.SP;
+	u8 rom_bank = bus.RomBank();	// El de la instruccion, antes de que la escritura lo cambie
+#endif
 	u8 cycles = Execute(opcode);
+#ifdef EMU_PROFILER
+	// El byte CB sale del fetch de Execute: leerlo de nuevo contaria un acceso de mas
+	u8 cb = opcode == 0xCB ? last_cb : 0;
+	if (profiler) profiler->OnInstruction(rom_bank, curr_pc, opcode, cb, cycles, old_sp, reg.val.SP, reg.val.PC);
+#endif
 
 	bus.TickTimer(cycles);
 
@@ -1011,6 +1234,9 @@ u8 Processor::Execute(u8 opcode) {
 		}
 		case 0xCB: {
 			u8 cb_op = bus.Read(reg.val.PC++);
+#ifdef EMU_PROFILER
+			last_cb = cb_op;
+#endif
 
 			if (cb_op >= 0x80) {
 					u8 bit = (cb_op >> 3) & 0x07; 
@@ -1410,6 +1636,24 @@ u8 Processor::Execute(u8 opcode) {
 
 	return 0;
 }
+void Processor::RestoreFrom(const Processor& tmpl) {
+	IME = tmpl.IME;
+	halted = tmpl.halted;
+	reg = tmpl.reg;
+	bus.RestoreFrom(tmpl.bus);
+}
+void Processor::SaveState(StateWriter& state) const {
+	state.Put(IME);
+	state.Put(halted);
+	state.Put(reg.val);
+	bus.SaveState(state);
+}
+void Processor::LoadState(StateReader& state) {
+	state.Get(IME);
+	state.Get(halted);
+	state.Get(reg.val);
+	bus.LoadState(state);
+}
 bool Processor::LoadROM(const char* path) {
 	return bus.LoadROM(path);
 }
@@ -1428,6 +1672,9 @@ void Processor::HandleInterrupts() {
                 IME = false; 
 				halted = false;
                 bus.Write(0xFF0F, IF & ~(1 << i));
+#ifdef EMU_PROFILER
+				if (profiler) profiler->OnInterrupt(i, reg.val.SP);
+#endif
                 com.PUSH(bus, reg.val.SP, reg.val.PC); 
 
                 switch (i) {
@@ -3,6 +3,8 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <memory>
+#include <algorithm>
 
 #pragma once
 
@@ -13,6 +15,8 @@ namespace CPU {
 	using u8 = uint8_t;
 	using u16 = uint16_t;
 	using s8 = int8_t;
+	using u32 = uint32_t;
+	using u64 = uint64_t;
 	
 	struct RegisterPair {
 		union {
@@ -74,17 +78,96 @@ namespace CPU {
 		Flags flag;
 
 		Register() : flag(val.F) {}
+		// Flags guarda una referencia a F: al copiar hay que re-apuntarla al registro propio
+		Register(const Register& other) : val(other.val), flag(val.F) {}
+		Register& operator=(const Register& other) { val = other.val; return *this; }
 
 		void Init();
 	};
 
+	// Serializacion de save states: volcado binario campo por campo
+	struct StateWriter {
+		std::vector<u8>& out;
+
+		void Bytes(const void* data, size_t size) {
+			const u8* bytes = (const u8*)data;
+			out.insert(out.end(), bytes, bytes + size);
+		}
+		template <typename T> void Put(const T& value) { Bytes(&value, sizeof(T)); }
+	};
+
+	struct StateReader {
+		const u8* data;
+		size_t size;
+		size_t pos = 0;
+		bool ok = true;
+
+		void Bytes(void* dest, size_t count) {
+			if (!ok || pos + count > size) { ok = false; return; }
+			std::copy_n(data + pos, count, (u8*)dest);
+			pos += count;
+		}
+		template <typename T> void Get(T& value) { Bytes(&value, sizeof(T)); }
+	};
+
+	// Registros del LCD tal como estan en io[0x40-0x4B]
+	struct LcdRegisters {
+		u8 LCDC;
+		u8 STAT;
+		u8 SCY;
+		u8 SCX;
+		u8 LY;
+		u8 LYC;
+		u8 DMA;
+		u8 BGP;
+		u8 OBP0;
+		u8 OBP1;
+		u8 WY;
+		u8 WX;
+	};
+	static_assert(sizeof(LcdRegisters) == 12, "LcdRegisters tiene que calzar sobre io[0x40-0x4B]");
+
+	// Tiles de 0x8000-0x97FF decodificados a indices de color (0-3), un byte por pixel.
+	// pixels[1] es la version espejada en X para sprites. Un tile queda sucio cuando
+	// Memory_Bus::Write toca alguno de sus 16 bytes y se redecodifica al primer uso.
+	struct TileCache {
+		static const int TILES = 384;
+
+		u8 pixels[2][TILES][64];
+		u64 dirty[TILES / 64];
+		u32 generation[TILES] = {};	// Sube en cada redecodificacion (visor de tiles)
+
+		TileCache() { MarkAll(); }
+		void Mark(int tile) { dirty[tile >> 6] |= 1ull << (tile & 63); }
+		void MarkAll() { std::fill(std::begin(dirty), std::end(dirty), ~0ull); }
+		bool IsDirty(int tile) const { return (dirty[tile >> 6] >> (tile & 63)) & 1; }
+		void Decode(const u8* vram, int tile);
+	};
+
+	class APU;
+#ifdef EMU_PROFILER
+	class Profiler;
+#endif
+#ifdef EMU_BUS_STATS
+	class BusStats;
+#endif
+
 	class Memory_Bus {
 	private:
-		std::vector<u8> rom;	// Cartucho
+		// Cartucho: inmutable, compartido entre clones de la misma instancia
+		std::shared_ptr<const std::vector<u8>> rom;
+		const u8* rom_data = nullptr;
+		size_t rom_size = 0;
 		u8 vram[0x2000];		// Video RAM (8KB)
 		u8 wram[0x2000];		// Work RAM (8KB)
 		u8 hram[0x80];			// High RAM
-		u8 io[0x80];			// IO Registers
+		union {
+			u8 io[0x80];			// IO Registers
+			struct {
+				u8 io_low[0x40];
+				LcdRegisters lcd;	// 0xFF40-0xFF4B
+			};
+		};
 		u8 oam[0xA0];
 		u8 ie_register;
 		int div_counter = 0;
@@ -98,12 +181,39 @@ namespace CPU {
         bool has_battery = false;
         std::string save_path = "";
 
+		// Paginas de 256 bytes escritas desde el ultimo RestoreFrom/ClearDirty
+		u32 vram_dirty = 0;
+		u32 wram_dirty = 0;
+		std::vector<u64> ext_dirty;
+
+		TileCache tiles;
+
+		// Indice de OAM: bit i de sprite_lines[alto][linea] = el sprite i cubre esa linea
+		// (alto 0 = 8x8, 1 = 8x16). Se actualiza al escribir el byte Y de un sprite y en la DMA.
+		u64 sprite_lines[2][144] = {};
+		void IndexSprite(int sprite, u8 old_y, u8 new_y);
+		void RebuildSpriteIndex();
+
+		// Registros de sonido (0xFF10-0xFF3F): lecturas y escrituras van al APU.
+		// Lo conecta GameBoy; sin APU quedan como IO comun.
+		APU* apu = nullptr;
+
+		// Escrituras a VRAM/OAM (address << 8 | valor) para el render en otro hilo
+		bool record_video = false;
+		std::vector<u32> video_writes;
+
+#ifdef EMU_BUS_STATS
+		BusStats* stats = nullptr;	// No es nuestro; RestoreFrom no lo pisa
+#endif
+
 	public:
 		Memory_Bus();
 		
 		u8 Read(u16 address);
 		void Write(u16 address, u8 value);
 		bool LoadROM(const char* path);
+		// Carga una ROM ya leida, sin tocar el .sav (batch runner, instancias embebidas)
+		void SetROM(std::shared_ptr<const std::vector<u8>> data);
 		void RequestInterrupt(u8 bit) {
 			u8 current_if = Read(0xFF0F);
 			Write(0xFF0F, current_if | (1 << bit));
@@ -146,6 +256,52 @@ namespace CPU {
 		void UpdateJoypad(int key, bool pressed);
 		void SaveGame();
 
+		// Template instances: vuelve al estado de 'tmpl' copiando solo las paginas sucias
+		void RestoreFrom(const Memory_Bus& tmpl);
+		void ClearDirty();
+
+		void SaveState(StateWriter& state) const;
+		void LoadState(StateReader& state);
+
+		// Vistas directas a la memoria viva (API embebible)
+		u8* GetVRAM() { return vram; }
+		u8* GetWRAM() { return wram; }
+		u8* GetHRAM() { return hram; }
+		u8* GetOAM() { return oam; }
+		u8* GetIO() { return io; }
+
+		// Acceso de solo lectura para la PPU, sin pasar por Read
+		const u8* GetVRAM() const { return vram; }	// 0x2000 bytes desde 0x8000
+		const u8* GetOAM() const { return oam; }	// 0xA0 bytes desde 0xFE00
+		const LcdRegisters& GetLCD() const { return lcd; }
+		u8 RomBank() const { return rom_bank; }	// Mapeado en 0x4000-0x7FFF
+		void SetLCD(const LcdRegisters& regs) { lcd = regs; }	// Solo para el bus espejo del render thread
+
+		void SetAPU(APU* unit) { apu = unit; }
+#ifdef EMU_BUS_STATS
+		void SetStats(BusStats* s) { stats = s; }
+		BusStats* GetStats() const { return stats; }
+#endif
+
+		void RecordVideoWrites(bool on) { record_video = on; video_writes.clear(); }
+		std::vector<u32>& VideoWrites() { return video_writes; }
+
+		// Tiles decodificados: 'tile' es 0-383 (bloques 0x8000/0x8800/0x9000 seguidos)
+		const u8* TileRow(int tile, int y, bool x_flip) {
+			if (tiles.IsDirty(tile)) tiles.Decode(vram, tile);
+			return tiles.pixels[x_flip][tile] + y * 8;
+		}
+		u32 TileGeneration(int tile) const { return tiles.generation[tile]; }
+		// Para cuando la VRAM se escribe por afuera de Write (vistas de la API embebible)
+		void InvalidateTiles() { tiles.MarkAll(); }
+		void InvalidateTile(int tile) { tiles.Mark(tile); }
+		// Idem para RestoreFrom: lo escrito por afuera de Write no queda marcado, se recopia todo
+		void MarkRamDirty() { vram_dirty = wram_dirty = 0xFFFFFFFF; }
+
+		// Sprites que cubren 'line', en orden de OAM (sin el limite de 10)
+		u64 SpritesOnLine(u8 line, bool tall) const { return sprite_lines[tall][line]; }
+		void InvalidateSprites() { RebuildSpriteIndex(); }
+
 		// DEBUG
 		void ShowMemory(u16 start, u16 end);
 		int GetRomSize();
@@ -222,6 +378,10 @@ namespace CPU {
 		Register reg;
 		Command com;
 		u8 Execute(u8 opcode);
+#ifdef EMU_PROFILER
+		Profiler* profiler = nullptr;	// No es nuestro; se copia como audio_output en GameBoy
+		u8 last_cb = 0;					// Segundo byte del ultimo 0xCB, leido por Execute
+#endif
 		
 		public:
 		Memory_Bus bus;
@@ -233,8 +393,20 @@ namespace CPU {
 		int GetRomSize();
 		u16 GetPC() const { return reg.val.PC; }
 		u16 GetHL() const { return reg.val.HL; }
+		const RegisterPair& GetRegisters() const { return reg.val; }
+		void SetRegisters(const RegisterPair& regs) { reg.val = regs; }
+		bool IsHalted() const { return halted; }
+		void SetHalted(bool value) { halted = value; }
+		bool GetIME() const { return IME; }
 		void HandleInterrupts();
+#ifdef EMU_PROFILER
+		void SetProfiler(Profiler* p) { profiler = p; }
+		Profiler* GetProfiler() const { return profiler; }
+#endif
 		void UpdateJoypad(int key, bool pressed) { bus.UpdateJoypad(key, pressed); }
 		void SaveGame() { bus.SaveGame(); }
+		void RestoreFrom(const Processor& tmpl);
+		void SaveState(StateWriter& state) const;
+		void LoadState(StateReader& state);
 	};
 }
@@ -0,0 +1,268 @@
+#include "Capture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace CPU;
+
+static const int FRAME_PIXELS = 160 * 144;
+static const u32 CLOCKS_PER_SECOND = 4194304;
+static const u32 CLOCKS_PER_FRAME = 70224;
+
+static void PutU16(std::ofstream& out, u16 value) {
+    u8 bytes[2] = {(u8)value, (u8)(value >> 8)};
+    out.write((const char*)bytes, 2);
+}
+
+static void PutU32(std::ofstream& out, u32 value) {
+    u8 bytes[4] = {(u8)value, (u8)(value >> 8), (u8)(value >> 16), (u8)(value >> 24)};
+    out.write((const char*)bytes, 4);
+}
+
+// Encabezado WAV con tamanios en 0; Close los completa
+static void WriteWavHeader(std::ofstream& out, u32 sample_rate, u32 data_bytes) {
+    out.write("RIFF", 4);
+    PutU32(out, 36 + data_bytes);
+    out.write("WAVEfmt ", 8);
+    PutU32(out, 16);
+    PutU16(out, 3);             // IEEE float
+    PutU16(out, 1);             // Mono
+    PutU32(out, sample_rate);
+    PutU32(out, sample_rate * 4);
+    PutU16(out, 4);
+    PutU16(out, 32);
+    out.write("data", 4);
+    PutU32(out, data_bytes);
+}
+
+bool CPU::WriteWavFile(const std::string& path, const float* samples, size_t count, int sample_rate) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    WriteWavHeader(out, (u32)sample_rate, (u32)(count * sizeof(float)));
+    out.write((const char*)samples, count * sizeof(float));
+    return out.good();
+}
+
+CaptureWriter::CaptureWriter() {
+    slots = std::make_unique<Slot[]>(SLOTS);
+    encoded.resize(FRAME_PIXELS);
+}
+
+bool CaptureWriter::Open(const std::string& video_path, bool is_realtime, int rate) {
+    Close();
+
+    std::string base = video_path;
+    size_t dot = base.find_last_of('.');
+    size_t slash = base.find_last_of("/\\");
+    std::string extension;
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        extension = base.substr(dot);
+        base = base.substr(0, dot);
+    }
+    y4m = extension == ".y4m";
+
+    video.open(video_path, std::ios::binary);
+    audio.open(base + ".wav", std::ios::binary);
+    if (!video.is_open() || !audio.is_open()) {
+        video.close();
+        audio.close();
+        return false;
+    }
+
+    if (y4m) {
+        video << "YUV4MPEG2 W160 H144 F" << CLOCKS_PER_SECOND << ":" << CLOCKS_PER_FRAME << " Ip A1:1 Cmono\n";
+    } else {
+        video.write("GBV1", 4);
+        PutU16(video, 160);
+        PutU16(video, 144);
+        PutU32(video, CLOCKS_PER_SECOND);
+        PutU32(video, CLOCKS_PER_FRAME);
+    }
+    sample_rate = (u32)rate;
+    WriteWavHeader(audio, sample_rate, 0);
+    // Que Submit no tenga que reservar en el hilo de emulacion (a 192 kHz son ~3200 por frame):
+    // un slot lleva su frame mas lo guardado de los descartados
+    size_t per_frame = (size_t)sample_rate * CLOCKS_PER_FRAME / CLOCKS_PER_SECOND + 1;
+    for (size_t i = 0; i < SLOTS; i++) slots[i].audio.reserve(per_frame * (CARRIED_AUDIO_FRAMES + 1));
+    carried_audio.clear();
+    carried_audio.reserve(per_frame * CARRIED_AUDIO_FRAMES);
+    pending_silence = 0;
+
+    filled = std::make_unique<SpscQueue<u32, SLOTS>>();
+    free_slots = std::make_unique<SpscQueue<u32, SLOTS>>();
+    for (u32 i = 0; i < SLOTS; i++) free_slots->Push(i);
+
+    realtime = is_realtime;
+    has_last = false;
+    pending_repeats = 0;
+    audio_bytes = 0;
+    stats = CaptureStats();
+    dropped = 0;
+    pending_drops = 0;
+    closing = false;
+    writer = std::thread(&CaptureWriter::Run, this);
+    return true;
+}
+
+bool CaptureWriter::Submit(const u8* frame, u32 serial, const std::vector<float>& samples) {
+    if (!IsOpen()) return false;
+
+    u32 index;
+    while (!free_slots->Pop(index)) {
+        if (realtime) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            pending_drops++;
+            CarryAudio(samples);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    Slot& slot = slots[index];
+    std::memcpy(slot.pixels, frame, FRAME_PIXELS);
+    slot.serial = serial;
+    slot.dropped_before = pending_drops;
+    slot.silence_before = pending_silence;
+    pending_drops = 0;
+    pending_silence = 0;
+    slot.audio.assign(carried_audio.begin(), carried_audio.end());
+    slot.audio.insert(slot.audio.end(), samples.begin(), samples.end());
+    carried_audio.clear();
+    filled->Push(index);    // Nunca llena: hay tantos indices como lugares
+
+    if (sleeping.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        wake.notify_one();
+    }
+    return true;
+}
+
+// Junta el audio de un frame descartado sin pasar de lo reservado: lo mas viejo sale
+// primero y queda contado como silencio
+void CaptureWriter::CarryAudio(const std::vector<float>& samples) {
+    size_t capacity = carried_audio.capacity();
+    size_t skip = samples.size() > capacity ? samples.size() - capacity : 0;
+    size_t keep = samples.size() - skip;
+    size_t excess = carried_audio.size() + keep > capacity ? carried_audio.size() + keep - capacity : 0;
+    carried_audio.erase(carried_audio.begin(), carried_audio.begin() + excess);
+    carried_audio.insert(carried_audio.end(), samples.begin() + skip, samples.end());
+    pending_silence += skip + excess;
+}
+
+void CaptureWriter::Run() {
+    u32 index;
+    while (true) {
+        if (!filled->Pop(index)) {
+            if (closing.load(std::memory_order_acquire) && filled->Size() == 0) return;
+            std::unique_lock<std::mutex> guard(wake_lock);
+            sleeping.store(true, std::memory_order_release);
+            wake.wait_for(guard, std::chrono::milliseconds(2), [this] {
+                return filled->Size() > 0 || closing.load(std::memory_order_acquire);
+            });
+            sleeping.store(false, std::memory_order_release);
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        WriteSlot(slots[index]);
+        stats.write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        free_slots->Push(index);
+    }
+}
+
+void CaptureWriter::WriteSlot(const Slot& slot) {
+    // Los descartados se guardan como el ultimo frame; su audio viene en este slot
+    u32 drops = slot.dropped_before;
+    if (drops > 0 && !has_last) {
+        WriteFrame(slot.pixels);
+        stats.stored++;
+        has_last = true;
+        last_serial = slot.serial;
+        drops--;
+    }
+    for (; drops > 0; drops--) {
+        if (y4m) WriteFrame(nullptr);
+        else pending_repeats++;
+    }
+
+    stats.frames++;
+    if (has_last && slot.serial == last_serial) {
+        stats.repeats++;
+        if (y4m) WriteFrame(nullptr);
+        else pending_repeats++;
+    } else {
+        FlushRepeats();
+        WriteFrame(slot.pixels);
+        stats.stored++;
+        has_last = true;
+        last_serial = slot.serial;
+    }
+
+    static const float SILENCE[1024] = {};
+    for (u64 left = slot.silence_before; left > 0;) {
+        size_t count = (size_t)std::min<u64>(left, 1024);
+        audio.write((const char*)SILENCE, count * sizeof(float));
+        audio_bytes += count * sizeof(float);
+        stats.audio_samples += count;
+        left -= count;
+    }
+    if (!slot.audio.empty()) {
+        size_t bytes = slot.audio.size() * sizeof(float);
+        audio.write((const char*)slot.audio.data(), bytes);
+        audio_bytes += bytes;
+        stats.audio_samples += slot.audio.size();
+    }
+}
+
+// nullptr: repite el ultimo frame ya codificado (Y4M no tiene repeticiones)
+void CaptureWriter::WriteFrame(const u8* frame) {
+    if (y4m) {
+        if (frame) ExpandFrame(frame, encoded.data(), 160, PIXEL_GRAY8, PALETTE_GRAY);
+        video.write("FRAME\n", 6);
+        video.write((const char*)encoded.data(), FRAME_PIXELS);
+        stats.bytes += 6 + FRAME_PIXELS;
+        return;
+    }
+
+    // 4 pixeles por byte: se leen de a u32 (little endian) y se juntan los 2 bits bajos
+    u8* out = encoded.data();
+    for (int i = 0; i < FRAME_PIXELS; i += 4) {
+        u32 quad;
+        std::memcpy(&quad, frame + i, 4);
+        quad &= 0x03030303;
+        out[i / 4] = (u8)(quad | (quad >> 6) | (quad >> 12) | (quad >> 18));
+    }
+    video.put('F');
+    video.write((const char*)out, FRAME_PIXELS / 4);
+    stats.bytes += 1 + FRAME_PIXELS / 4;
+}
+
+void CaptureWriter::FlushRepeats() {
+    if (pending_repeats == 0) return;
+    video.put('R');
+    PutU32(video, pending_repeats);
+    stats.bytes += 5;
+    pending_repeats = 0;
+}
+
+CaptureStats CaptureWriter::Close() {
+    if (!IsOpen()) return stats;
+
+    closing.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        wake.notify_one();
+    }
+    writer.join();
+
+    FlushRepeats();
+    video.close();
+
+    audio.seekp(0);
+    WriteWavHeader(audio, sample_rate, (u32)audio_bytes);
+    audio.close();
+
+    stats.bytes += audio_bytes + 44;
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Video.hpp"
+#include "SpscQueue.hpp"
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CPU {
+    struct CaptureStats {
+        u64 frames = 0;         // Recibidos con Submit
+        u64 stored = 0;         // Escritos completos
+        u64 repeats = 0;        // Guardados como repeticion del anterior
+        u64 dropped = 0;        // Sin slot libre (solo en tiempo real)
+        u64 audio_samples = 0;
+        u64 bytes = 0;
+        double write_seconds = 0.0;     // Tiempo del writer ocupado (empaquetar + escribir)
+    };
+
+    // WAV float 32 mono de una vez (mismo formato que el audio de la grabacion)
+    bool WriteWavFile(const std::string& path, const float* samples, size_t count, int sample_rate);
+
+    // Graba frames indexados y el audio del APU desde un hilo writer propio.
+    // El productor copia el frame y sus muestras a un slot preasignado y lo encola; nunca
+    // escribe a disco. Frames con el mismo serial que el anterior se guardan como repeticion.
+    //
+    // Video segun la extension:
+    //   .y4m  YUV4MPEG2 en escala de grises (Cmono), todos los frames completos
+    //   otra  GBV1: "GBV1" u16 ancho, u16 alto, u32 clocks/s, u32 clocks/frame y despues
+    //         registros 'F' + frame a 2 bits por pixel (4 por byte, el primero en los bits
+    //         bajos) o 'R' + u32 cantidad de repeticiones del ultimo frame
+    // Audio: mismo nombre con .wav, float 32 mono a la frecuencia del APU.
+    class CaptureWriter {
+        private:
+        static const size_t SLOTS = 64;
+        // Audio de frames descartados que se guarda para el proximo slot. Lo mas viejo que
+        // eso se reemplaza por silencio del mismo largo: el .wav no se corre y nada crece.
+        static const size_t CARRIED_AUDIO_FRAMES = 4;
+
+        struct Slot {
+            u8 pixels[160 * 144];
+            u32 serial = 0;
+            u32 dropped_before = 0;     // Frames descartados justo antes de este
+            u64 silence_before = 0;     // Muestras de esos frames que no se guardaron
+            std::vector<float> audio;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<SpscQueue<u32, SLOTS>> filled;     // Productor -> writer
+        std::unique_ptr<SpscQueue<u32, SLOTS>> free_slots; // Writer -> productor
+        std::thread writer;
+        bool realtime = true;
+
+        std::mutex wake_lock;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping{false};
+        std::atomic<bool> closing{false};
+
+        // Solo el writer
+        std::ofstream video;
+        std::ofstream audio;
+        bool y4m = false;
+        u32 sample_rate = 44100;
+        bool has_last = false;
+        u32 last_serial = 0;
+        u32 pending_repeats = 0;
+        std::vector<u8> encoded;
+        u64 audio_bytes = 0;
+
+        CaptureStats stats;
+        std::atomic<u64> dropped{0};
+        // Solo el productor
+        u32 pending_drops = 0;
+        std::vector<float> carried_audio;   // Reservado en Open, nunca crece
+        u64 pending_silence = 0;
+
+        void Run();
+        void CarryAudio(const std::vector<float>& samples);
+        void WriteSlot(const Slot& slot);
+        void WriteFrame(const u8* frame);
+        void FlushRepeats();
+
+        public:
+        CaptureWriter();
+        ~CaptureWriter() { Close(); }
+
+        // realtime: con la cola llena Submit descarta el frame en vez de esperar
+        // sample_rate: la del APU que genera el audio
+        bool Open(const std::string& video_path, bool realtime, int sample_rate = 44100);
+        bool IsOpen() const { return writer.joinable(); }
+
+        // Hilo de emulacion, una vez por frame. false = descartado (tiempo real sin slot
+        // libre): el writer guarda las muestras y salen con el proximo frame. El descarte
+        // queda en el video como repeticion, asi video y audio no se corren.
+        bool Submit(const u8* frame, u32 serial, const std::vector<float>& samples);
+
+        // Escribe lo pendiente, completa los encabezados y cierra
+        CaptureStats Close();
+    };
+}
@@ -0,0 +1,193 @@
+#include "DebugViewers.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace CPU;
+
+// Posicion de cada panel en la ventana (coordenadas logicas)
+static const SDL_Rect SHEET_RECT = {0, 0, 128, 192};
+static const SDL_Rect MAP_RECT[2] = {{136, 0, 256, 256}, {400, 0, 256, 256}};
+static const SDL_Rect OAM_RECT = {0, 200, 128, 80};
+static const int WINDOW_WIDTH = 656, WINDOW_HEIGHT = 280;
+
+bool DebugViewers::Open(const Palette& pal) {
+    if (IsOpen()) return true;
+
+    window = SDL_CreateWindow("C++ Boy - VRAM", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                              WINDOW_WIDTH * 2, WINDOW_HEIGHT * 2, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    if (!window) return false;
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    if (!renderer) {
+        Close();
+        return false;
+    }
+    SDL_RenderSetLogicalSize(renderer, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    sheet_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SHEET_WIDTH, SHEET_HEIGHT);
+    for (int m = 0; m < 2; m++) {
+        map_texture[m] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, MAP_SIZE, MAP_SIZE);
+    }
+    oam_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, OAM_WIDTH, OAM_HEIGHT);
+    if (!sheet_texture || !map_texture[0] || !map_texture[1] || !oam_texture) {
+        Close();
+        return false;
+    }
+
+    palette = pal;
+    sheet_pixels.assign(SHEET_WIDTH * SHEET_HEIGHT, palette.argb[0]);
+    for (int m = 0; m < 2; m++) map_pixels[m].assign(MAP_SIZE * MAP_SIZE, palette.argb[0]);
+    oam_pixels.assign(OAM_WIDTH * OAM_HEIGHT, palette.argb[0]);
+    has_snapshot = false;
+    return true;
+}
+
+void DebugViewers::Close() {
+    if (sheet_texture) SDL_DestroyTexture(sheet_texture);
+    for (SDL_Texture*& texture : map_texture) {
+        if (texture) SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+    if (oam_texture) SDL_DestroyTexture(oam_texture);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (window) SDL_DestroyWindow(window);
+    sheet_texture = oam_texture = nullptr;
+    renderer = nullptr;
+    window = nullptr;
+}
+
+void DebugViewers::DrawTile(u32* dst, int pitch, int tile, const u32* colors) {
+    const u8* indices = tiles.pixels[0][tile];
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) dst[y * pitch + x] = colors[indices[y * 8 + x]];
+    }
+}
+
+// Sube solo las filas de tiles [first_row, last_row]
+void DebugViewers::UpdateSheet(int first_row, int last_row) {
+    SDL_Rect rows = {0, first_row * 8, SHEET_WIDTH, (last_row - first_row + 1) * 8};
+    SDL_UpdateTexture(sheet_texture, &rows, &sheet_pixels[rows.y * SHEET_WIDTH], SHEET_WIDTH * sizeof(u32));
+}
+
+void DebugViewers::UpdateMap(int map, const VideoSnapshot& snapshot, bool full) {
+    const LcdRegisters& lcd = snapshot.lcd;
+    u32 colors[4];
+    for (int i = 0; i < 4; i++) colors[i] = palette.argb[(lcd.BGP >> (i * 2)) & 0x03];
+
+    const u8* cells = snapshot.vram + (map ? 0x1C00 : 0x1800);
+    bool unsigned_tiles = (lcd.LCDC & 0x10) != 0;
+    int first_row = 32, last_row = -1;
+
+    for (int cell = 0; cell < 1024; cell++) {
+        int tile = unsigned_tiles ? cells[cell] : 256 + (s8)cells[cell];
+        if (!full && map_tiles[map][cell] == tile && !tile_changed[tile]) continue;
+
+        map_tiles[map][cell] = (u16)tile;
+        int row = cell / 32;
+        DrawTile(&map_pixels[map][row * 8 * MAP_SIZE + (cell % 32) * 8], MAP_SIZE, tile, colors);
+        first_row = std::min(first_row, row);
+        last_row = std::max(last_row, row);
+    }
+
+    if (last_row >= first_row) {
+        SDL_Rect rows = {0, first_row * 8, MAP_SIZE, (last_row - first_row + 1) * 8};
+        SDL_UpdateTexture(map_texture[map], &rows, &map_pixels[map][rows.y * MAP_SIZE], MAP_SIZE * sizeof(u32));
+    }
+}
+
+// 40 celdas de 16x16: fondo claro si el sprite cae en pantalla, oscuro si no.
+// El color 0 del sprite es transparente.
+void DebugViewers::UpdateOAM(const VideoSnapshot& snapshot) {
+    const LcdRegisters& lcd = snapshot.lcd;
+    bool tall = (lcd.LCDC & 0x04) != 0;
+    u32 visible_bg = 0xFF404040, hidden_bg = 0xFF202020;
+
+    for (int sprite = 0; sprite < 40; sprite++) {
+        const u8* entry = snapshot.oam + sprite * 4;
+        u8 y = entry[0], x = entry[1], tile = entry[2], attributes = entry[3];
+        bool visible = y > 0 && y < 160 && x > 0 && x < 168;
+        u8 obp = (attributes & 0x10) ? lcd.OBP1 : lcd.OBP0;
+        bool x_flip = (attributes & 0x20) != 0, y_flip = (attributes & 0x40) != 0;
+
+        u32* cell = &oam_pixels[(sprite / 8) * 16 * OAM_WIDTH + (sprite % 8) * 16];
+        for (int row = 0; row < 16; row++) std::fill_n(cell + row * OAM_WIDTH, 16, visible ? visible_bg : hidden_bg);
+
+        int height = tall ? 16 : 8;
+        for (int row = 0; row < height; row++) {
+            int line = y_flip ? height - 1 - row : row;
+            int index = tall ? ((tile & 0xFE) + line / 8) : tile;
+            const u8* indices = tiles.pixels[x_flip][index] + (line % 8) * 8;
+            u32* out = cell + row * OAM_WIDTH + 4;
+            for (int px = 0; px < 8; px++) {
+                if (indices[px]) out[px] = palette.argb[(obp >> (indices[px] * 2)) & 0x03];
+            }
+        }
+    }
+    SDL_UpdateTexture(oam_texture, nullptr, oam_pixels.data(), OAM_WIDTH * sizeof(u32));
+}
+
+void DebugViewers::Update(const VideoSnapshot& snapshot) {
+    if (!IsOpen()) return;
+    auto start = std::chrono::steady_clock::now();
+
+    // Tiles: se comparan los 16 bytes contra la ultima VRAM vista
+    int first_row = 24, last_row = -1;
+    bool any_tile = false;
+    for (int tile = 0; tile < TileCache::TILES; tile++) {
+        const u8* data = snapshot.vram + tile * 16;
+        tile_changed[tile] = !has_snapshot || std::memcmp(data, last.vram + tile * 16, 16) != 0;
+        if (!tile_changed[tile]) continue;
+
+        tiles.Decode(snapshot.vram, tile);
+        tiles_decoded++;
+        any_tile = true;
+
+        // La hoja va sin paleta: indices crudos
+        int row = tile / 16;
+        DrawTile(&sheet_pixels[row * 8 * SHEET_WIDTH + (tile % 16) * 8], SHEET_WIDTH, tile, palette.argb);
+        first_row = std::min(first_row, row);
+        last_row = std::max(last_row, row);
+    }
+    if (any_tile) UpdateSheet(first_row, last_row);
+
+    // Mapas: todo de nuevo si cambio la paleta o el direccionamiento de tiles
+    bool full = !has_snapshot || snapshot.lcd.BGP != last.lcd.BGP || ((snapshot.lcd.LCDC ^ last.lcd.LCDC) & 0x10);
+    for (int m = 0; m < 2; m++) UpdateMap(m, snapshot, full);
+
+    if (!has_snapshot || any_tile || std::memcmp(snapshot.oam, last.oam, sizeof(last.oam)) != 0 ||
+        snapshot.lcd.OBP0 != last.lcd.OBP0 || snapshot.lcd.OBP1 != last.lcd.OBP1 ||
+        ((snapshot.lcd.LCDC ^ last.lcd.LCDC) & 0x04)) {
+        UpdateOAM(snapshot);
+    }
+
+    last = snapshot;
+    has_snapshot = true;
+    update_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    updates++;
+}
+
+void DebugViewers::Present() {
+    if (!IsOpen()) return;
+
+    SDL_SetRenderDrawColor(renderer, 0x30, 0x30, 0x30, 255);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, sheet_texture, nullptr, &SHEET_RECT);
+    for (int m = 0; m < 2; m++) SDL_RenderCopy(renderer, map_texture[m], nullptr, &MAP_RECT[m]);
+    SDL_RenderCopy(renderer, oam_texture, nullptr, &OAM_RECT);
+
+    // Viewport de 160x144 sobre el mapa activo; si pasa el borde se repite del otro lado
+    if (has_snapshot) {
+        const SDL_Rect& area = MAP_RECT[(last.lcd.LCDC & 0x08) ? 1 : 0];
+        SDL_RenderSetClipRect(renderer, &area);
+        SDL_SetRenderDrawColor(renderer, 0xFF, 0x30, 0x30, 255);
+        for (int dy = 0; dy <= MAP_SIZE; dy += MAP_SIZE) {
+            for (int dx = 0; dx <= MAP_SIZE; dx += MAP_SIZE) {
+                SDL_Rect view = {area.x + last.lcd.SCX - dx, area.y + last.lcd.SCY - dy, 160, 144};
+                SDL_RenderDrawRect(renderer, &view);
+            }
+        }
+        SDL_RenderSetClipRect(renderer, nullptr);
+    }
+
+    SDL_RenderPresent(renderer);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "CPU.hpp"
+#include "Video.hpp"
+#include <SDL2/SDL.h>
+#include <vector>
+
+namespace CPU {
+    // Lo que miran los visores, copiado por el hilo de emulacion al publicar cada frame
+    struct VideoSnapshot {
+        u8 vram[0x2000];
+        u8 oam[0xA0];
+        LcdRegisters lcd;
+    };
+
+    // Ventana de debug con la hoja de tiles, los dos mapas de fondo (0x9800/0x9C00, el
+    // activo con el viewport de SCX/SCY) y los 40 sprites de OAM.
+    // Cada panel tiene su textura streaming y su copia ARGB. En cada Update solo se
+    // decodifican los tiles cuyos 16 bytes cambiaron, solo se redibujan las celdas de mapa
+    // que apuntan a otro tile o a un tile cambiado, y solo se sube la franja modificada.
+    class DebugViewers {
+        private:
+        static const int SHEET_WIDTH = 128, SHEET_HEIGHT = 192;    // 16x24 tiles
+        static const int MAP_SIZE = 256;
+        static const int OAM_WIDTH = 128, OAM_HEIGHT = 80;          // 8x5 celdas de 16x16
+        static const u16 NOT_DRAWN = 0xFFFF;
+
+        SDL_Window* window = nullptr;
+        SDL_Renderer* renderer = nullptr;
+        SDL_Texture* sheet_texture = nullptr;
+        SDL_Texture* map_texture[2] = {};
+        SDL_Texture* oam_texture = nullptr;
+        Palette palette;
+
+        bool has_snapshot = false;
+        VideoSnapshot last;
+        TileCache tiles;
+        bool tile_changed[TileCache::TILES];
+        u16 map_tiles[2][1024];     // Tile (0-383) dibujado en cada celda
+
+        std::vector<u32> sheet_pixels;
+        std::vector<u32> map_pixels[2];
+        std::vector<u32> oam_pixels;
+
+        void DrawTile(u32* dst, int pitch, int tile, const u32* colors);
+        void UpdateSheet(int first_row, int last_row);
+        void UpdateMap(int map, const VideoSnapshot& snapshot, bool full);
+        void UpdateOAM(const VideoSnapshot& snapshot);
+
+        public:
+        u64 tiles_decoded = 0;
+        u64 update_ns = 0;
+        int updates = 0;
+
+        ~DebugViewers() { Close(); }
+
+        bool Open(const Palette& palette);
+        void Close();
+        bool IsOpen() const { return window != nullptr; }
+        u32 WindowID() const { return window ? SDL_GetWindowID(window) : 0; }
+
+        void Update(const VideoSnapshot& snapshot);
+        void Present();
+    };
+}
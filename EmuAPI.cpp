@@ -0,0 +1,201 @@
+#include "EmuAPI.h"
+#include "GameBoy.hpp"
+#include <atomic>
+#include <cstring>
+
+using namespace CPU;
+
+static std::atomic<u64> next_instance_id{1};
+
+struct emu_instance {
+    GameBoy gb;
+    // Se entrego una vista de VRAM/OAM: la cache de tiles o el indice de sprites pueden estar
+    // viejos. Se compara contra la copia tomada despues del ultimo cambio hecho por la
+    // maquina y solo se invalida lo que el caller escribio.
+    bool vram_exposed = false;
+    bool oam_exposed = false;
+    u8 tiles_seen[0x1800];
+    u8 oam_seen[0xA0];
+    // Se entrego una vista de WRAM/VRAM: lo escrito por ahi no marca paginas sucias
+    bool ram_exposed = false;
+
+    // Contrato de ResetTo: la instancia salio (clone o reset) de 'source_id' cuando este
+    // iba por 'source_generation', y el template no cambio desde entonces
+    u64 id = next_instance_id++;
+    u64 generation = 0;         // Sube cada vez que cambia el estado de la maquina
+    u64 source_id = 0;
+    u64 source_generation = 0;
+};
+
+int emu_api_version(void) {
+    return EMU_API_VERSION;
+}
+
+// Lo que la maquina dejo en VRAM/OAM, para detectar escrituras por las vistas
+static void SnapshotViews(emu_instance* emu) {
+    if (emu->vram_exposed) std::memcpy(emu->tiles_seen, emu->gb.cpu.bus.GetVRAM(), sizeof(emu->tiles_seen));
+    if (emu->oam_exposed) std::memcpy(emu->oam_seen, emu->gb.cpu.bus.GetOAM(), sizeof(emu->oam_seen));
+}
+
+static void InvalidateWrittenViews(emu_instance* emu) {
+    Memory_Bus& bus = emu->gb.cpu.bus;
+    if (emu->vram_exposed) {
+        const u8* vram = bus.GetVRAM();
+        for (int tile = 0; tile < TileCache::TILES; tile++) {
+            if (std::memcmp(vram + tile * 16, emu->tiles_seen + tile * 16, 16) != 0) bus.InvalidateTile(tile);
+        }
+    }
+    if (emu->oam_exposed && std::memcmp(bus.GetOAM(), emu->oam_seen, sizeof(emu->oam_seen)) != 0) bus.InvalidateSprites();
+}
+
+emu_instance* emu_create(void) {
+    emu_instance* emu = new emu_instance();
+    emu->gb.Init();
+    return emu;
+}
+
+void emu_destroy(emu_instance* emu) {
+    delete emu;
+}
+
+int emu_load_rom(emu_instance* emu, const uint8_t* data, size_t size) {
+    if (!emu || !data || size == 0) return -1;
+
+    // Se asigna sobre el mismo objeto para que las vistas ya entregadas sigan siendo validas
+    auto fresh = std::make_unique<GameBoy>();
+    fresh->Init();
+    fresh->SetROM(std::make_shared<const std::vector<u8>>(data, data + size));
+    emu->gb = *fresh;
+    emu->generation++;
+    SnapshotViews(emu);
+    return 0;
+}
+
+emu_instance* emu_clone(const emu_instance* tmpl) {
+    if (!tmpl) return nullptr;
+    emu_instance* emu = new emu_instance();
+    emu->gb.CloneFrom(tmpl->gb);
+    emu->source_id = tmpl->id;
+    emu->source_generation = tmpl->generation;
+    return emu;
+}
+
+void emu_reset_to(emu_instance* emu, const emu_instance* tmpl) {
+    if (!emu || !tmpl || emu == tmpl) return;
+    if (emu->source_id != tmpl->id || emu->source_generation != tmpl->generation) {
+        // Otro template, o el template corrio: las paginas sucias no alcanzan, copia entera
+        emu->gb.CloneFrom(tmpl->gb);
+    } else {
+        if (emu->ram_exposed) emu->gb.cpu.bus.MarkRamDirty();
+        emu->gb.ResetTo(tmpl->gb);
+    }
+    emu->source_id = tmpl->id;
+    emu->source_generation = tmpl->generation;
+    emu->generation++;
+    SnapshotViews(emu);
+}
+
+void emu_set_joypad(emu_instance* emu, uint8_t buttons) {
+    if (emu) emu->gb.SetJoypad(buttons);
+}
+
+int emu_run_frames(emu_instance* emu, int frames) {
+    if (!emu) return 0;
+    InvalidateWrittenViews(emu);
+    int done = 0;
+    while (done < frames && emu->gb.RunFrame()) done++;
+    emu->generation++;
+    SnapshotViews(emu);
+    return done;
+}
+
+size_t emu_state_size(const emu_instance* emu) {
+    if (!emu) return 0;
+    std::vector<u8> state;
+    emu->gb.SaveState(state);
+    return state.size();
+}
+
+size_t emu_save_state(const emu_instance* emu, uint8_t* buffer, size_t capacity) {
+    if (!emu || !buffer) return 0;
+    std::vector<u8> state;
+    emu->gb.SaveState(state);
+    if (state.size() > capacity) return 0;
+    std::copy(state.begin(), state.end(), buffer);
+    return state.size();
+}
+
+int emu_load_state(emu_instance* emu, const uint8_t* buffer, size_t size) {
+    if (!emu || !buffer) return -1;
+    if (!emu->gb.LoadState(buffer, size)) return -1;
+    emu->generation++;
+    SnapshotViews(emu);
+    return 0;
+}
+
+emu_view emu_framebuffer(emu_instance* emu) {
+    emu_view view = {nullptr, 0, 0};
+    if (!emu) return view;
+    view.data = (uint8_t*)emu->gb.ppu.GetFrame();
+    view.element_size = 1;
+    view.length = SCREEN_WIDTH * SCREEN_HEIGHT;
+    return view;
+}
+
+uint32_t emu_frame_serial(const emu_instance* emu) {
+    return emu ? emu->gb.ppu.FrameSerial() : 0;
+}
+
+int emu_convert_frame(const emu_instance* emu, int format, const uint32_t* palette, void* dst, size_t pitch) {
+    if (!emu || !dst || format < EMU_PIXEL_ARGB8888 || format > EMU_PIXEL_GRAY8) return -1;
+    if (pitch < (size_t)(SCREEN_WIDTH * BytesPerPixel((PixelFormat)format))) return -1;
+
+    Palette colors = PALETTE_GRAY;
+    if (palette) std::copy(palette, palette + 4, colors.argb);
+    ExpandFrame(emu->gb.ppu.GetFrame(), dst, (int)pitch, (PixelFormat)format, colors);
+    return 0;
+}
+
+emu_view emu_memory(emu_instance* emu, int region) {
+    emu_view view = {nullptr, 0, 1};
+    if (!emu) return view;
+    Memory_Bus& bus = emu->gb.cpu.bus;
+    switch (region) {
+        case EMU_REGION_WRAM:
+            view.data = bus.GetWRAM();
+            view.length = 0x2000;
+            emu->ram_exposed = true;
+            break;
+        case EMU_REGION_HRAM: view.data = bus.GetHRAM(); view.length = 0x7F; break;
+        case EMU_REGION_OAM:
+            view.data = bus.GetOAM();
+            view.length = 0xA0;
+            // Solo esta region: la otra vista ya entregada puede tener escrituras pendientes
+            if (!emu->oam_exposed) {
+                emu->oam_exposed = true;
+                std::memcpy(emu->oam_seen, bus.GetOAM(), sizeof(emu->oam_seen));
+            }
+            break;
+        case EMU_REGION_VRAM:
+            view.data = bus.GetVRAM();
+            view.length = 0x2000;
+            if (!emu->vram_exposed) {
+                emu->vram_exposed = true;
+                std::memcpy(emu->tiles_seen, bus.GetVRAM(), sizeof(emu->tiles_seen));
+            }
+            emu->ram_exposed = true;
+            break;
+        case EMU_REGION_IO:   view.data = bus.GetIO();   view.length = 0x80; break;
+    }
+    return view;
+}
+
+uint8_t emu_read(emu_instance* emu, uint16_t address) {
+    return emu ? emu->gb.cpu.bus.Read(address) : 0xFF;
+}
+
+void emu_write(emu_instance* emu, uint16_t address, uint8_t value) {
+    if (!emu) return;
+    emu->gb.cpu.bus.Write(address, value);
+    emu->generation++;
+}
@@ -0,0 +1,113 @@
+#ifndef EMU_API_H
+#define EMU_API_H
+
+/*
+ * C ABI para embeber el emulador (loops de entrenamiento, tooling de tests).
+ * Cada emu_instance es independiente: se pueden usar instancias distintas desde
+ * hilos distintos al mismo tiempo. Una misma instancia no es thread-safe.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define EMU_API __declspec(dllexport)
+#else
+#define EMU_API __attribute__((visibility("default")))
+#endif
+
+#define EMU_API_VERSION 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct emu_instance emu_instance;
+
+/* Vista sobre memoria viva de la instancia: sin copias. Valida hasta emu_destroy. */
+typedef struct {
+    uint8_t* data;
+    size_t length;          /* en bytes */
+    size_t element_size;    /* bytes por elemento (framebuffer: bytes por pixel) */
+} emu_view;
+
+enum emu_region {
+    EMU_REGION_WRAM = 0,    /* 0xC000-0xDFFF */
+    EMU_REGION_HRAM = 1,    /* 0xFF80-0xFFFE */
+    EMU_REGION_OAM  = 2,    /* 0xFE00-0xFE9F */
+    EMU_REGION_VRAM = 3,    /* 0x8000-0x9FFF */
+    EMU_REGION_IO   = 4     /* 0xFF00-0xFF7F */
+};
+
+/* Formatos de emu_convert_frame */
+enum emu_pixel_format {
+    EMU_PIXEL_ARGB8888 = 0,
+    EMU_PIXEL_RGB565   = 1,
+    EMU_PIXEL_GRAY8    = 2
+};
+
+/* Bits de emu_set_joypad: 1 = apretado */
+enum emu_button {
+    EMU_BUTTON_RIGHT  = 1 << 0,
+    EMU_BUTTON_LEFT   = 1 << 1,
+    EMU_BUTTON_UP     = 1 << 2,
+    EMU_BUTTON_DOWN   = 1 << 3,
+    EMU_BUTTON_A      = 1 << 4,
+    EMU_BUTTON_B      = 1 << 5,
+    EMU_BUTTON_SELECT = 1 << 6,
+    EMU_BUTTON_START  = 1 << 7
+};
+
+EMU_API int emu_api_version(void);
+
+EMU_API emu_instance* emu_create(void);
+EMU_API void emu_destroy(emu_instance* emu);
+
+/* Copia la ROM y enciende la maquina. 0 = ok. */
+EMU_API int emu_load_rom(emu_instance* emu, const uint8_t* data, size_t size);
+
+/* Template instances: clon que comparte la ROM, y reset barato contra el template.
+ * emu_reset_to solo recopia las paginas de RAM que 'emu' ensucio, y eso vale si 'emu' salio
+ * de emu_clone(tmpl) o del ultimo emu_reset_to(emu, tmpl), y 'tmpl' no corrio, no cargo ROM
+ * ni estado desde entonces. Si no se cumple, emu_reset_to hace una copia entera (correcta,
+ * pero tan cara como emu_clone). Escribir en 'tmpl' a traves de sus vistas no se detecta:
+ * el template no se toca despues de clonarlo. */
+EMU_API emu_instance* emu_clone(const emu_instance* tmpl);
+EMU_API void emu_reset_to(emu_instance* emu, const emu_instance* tmpl);
+
+EMU_API void emu_set_joypad(emu_instance* emu, uint8_t buttons);
+
+/* Devuelve los frames corridos; menos que 'frames' si el CPU se detuvo */
+EMU_API int emu_run_frames(emu_instance* emu, int frames);
+
+EMU_API size_t emu_state_size(const emu_instance* emu);
+/* Devuelve los bytes escritos, o 0 si 'capacity' no alcanza */
+EMU_API size_t emu_save_state(const emu_instance* emu, uint8_t* buffer, size_t capacity);
+/* 0 = ok; la instancia queda intacta si el estado es invalido */
+EMU_API int emu_load_state(emu_instance* emu, const uint8_t* buffer, size_t size);
+
+/* Ultimo frame completo: 160x144, fila por fila, un byte por pixel con el tono 0-3 (0 = blanco) */
+EMU_API emu_view emu_framebuffer(emu_instance* emu);
+/* Cambia solo cuando el frame completo difiere del anterior (para saltear observaciones repetidas) */
+EMU_API uint32_t emu_frame_serial(const emu_instance* emu);
+/* Expande el ultimo frame completo a 'format' con 'palette' (4 colores 0xAARRGGBB, NULL = grises).
+ * 'pitch' = bytes por fila de 'dst'. Solo lee la instancia. 0 = ok. */
+EMU_API int emu_convert_frame(const emu_instance* emu, int format, const uint32_t* palette, void* dst, size_t pitch);
+/* Las vistas son escribibles; lo escrito en VRAM u OAM se ve desde el proximo emu_run_frames.
+ * Con una vista de WRAM o VRAM entregada, emu_reset_to recopia esas regiones enteras
+ * (lo escrito por la vista no queda marcado como pagina sucia).
+ * En la vista de IO, 0xFF10-0xFF3F (sonido) son los bytes tal como se escribieron: no tienen
+ * las mascaras de lectura y escribirlos ahi no llega al APU. Esos registros van por
+ * emu_read/emu_write. */
+EMU_API emu_view emu_memory(emu_instance* emu, int region);
+
+/* Un byte a traves del bus, como el CPU (registros de sonido, MBC, DMA...).
+ * emu_write sobre un template cuenta como un cambio: el proximo emu_reset_to copia entero. */
+EMU_API uint8_t emu_read(emu_instance* emu, uint16_t address);
+EMU_API void emu_write(emu_instance* emu, uint16_t address, uint8_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,406 @@
+#include "Filters.hpp"
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+using namespace CPU;
+
+static const int PAD = 2;
+static const int PADDED_WIDTH = SCREEN_WIDTH + PAD * 2;
+static const int PADDED_HEIGHT = SCREEN_HEIGHT + PAD * 2;
+static_assert(SCREEN_WIDTH % 16 == 0, "los kernels SSE procesan filas enteras de a 16");
+
+static const FilterInfo FILTERS[FILTER_COUNT] = {
+    {"nearest", 0, false},
+    {"scale2x", 2, false},
+    {"scale3x", 3, false},
+    {"xbr2x", 2, false},
+    {"lcd3x", 3, true},
+};
+
+const FilterInfo& CPU::GetFilterInfo(FilterType type) {
+    return FILTERS[type];
+}
+
+bool CPU::FindFilter(const std::string& name, FilterType& type) {
+    for (int i = 0; i < FILTER_COUNT; i++) {
+        if (name == FILTERS[i].name) {
+            type = (FilterType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static u8 Luma(u32 argb) {
+    u32 r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+    return (u8)((r * 77 + g * 150 + b * 29) >> 8);
+}
+
+static u32 Average(u32 a, u32 b) {
+    u32 out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        out |= ((((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + 1) / 2) << shift;
+    }
+    return out;
+}
+
+// Indices 0-15 -> ARGB. Cada byte del color sale de su propia tabla con pshufb y
+// despues se entrelazan los 4 planos.
+static void ExpandColors(const u8* src, u32* dst, int count, const u32* colors) {
+    int x = 0;
+#if defined(__SSSE3__)
+    u8 planes[4][16];
+    for (int i = 0; i < 16; i++) {
+        for (int b = 0; b < 4; b++) planes[b][i] = (u8)(colors[i] >> (b * 8));
+    }
+    __m128i lut0 = _mm_loadu_si128((const __m128i*)planes[0]);
+    __m128i lut1 = _mm_loadu_si128((const __m128i*)planes[1]);
+    __m128i lut2 = _mm_loadu_si128((const __m128i*)planes[2]);
+    __m128i lut3 = _mm_loadu_si128((const __m128i*)planes[3]);
+    for (; x + 16 <= count; x += 16) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i b0 = _mm_shuffle_epi8(lut0, idx);
+        __m128i b1 = _mm_shuffle_epi8(lut1, idx);
+        __m128i b2 = _mm_shuffle_epi8(lut2, idx);
+        __m128i b3 = _mm_shuffle_epi8(lut3, idx);
+        __m128i lo01 = _mm_unpacklo_epi8(b0, b1), hi01 = _mm_unpackhi_epi8(b0, b1);
+        __m128i lo23 = _mm_unpacklo_epi8(b2, b3), hi23 = _mm_unpackhi_epi8(b2, b3);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_unpacklo_epi16(lo01, lo23));
+        _mm_storeu_si128((__m128i*)(dst + x + 4), _mm_unpackhi_epi16(lo01, lo23));
+        _mm_storeu_si128((__m128i*)(dst + x + 8), _mm_unpacklo_epi16(hi01, hi23));
+        _mm_storeu_si128((__m128i*)(dst + x + 12), _mm_unpackhi_epi16(hi01, hi23));
+    }
+#endif
+    for (; x < count; x++) dst[x] = colors[src[x] & 0x0F];
+}
+
+#if defined(__SSSE3__)
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+static inline __m128i Not(__m128i a) {
+    return _mm_xor_si128(a, _mm_set1_epi8((char)0xFF));
+}
+static inline __m128i Distance(__m128i a, __m128i b) {
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+#endif
+
+FrameFilter::FrameFilter(FilterType type, int nearest_scale, const Palette& palette)
+    : type(type), palette(palette) {
+    scale = FILTERS[type].scale ? FILTERS[type].scale : std::max(1, std::min(nearest_scale, 8));
+    padded.assign(PADDED_WIDTH * PADDED_HEIGHT, 0);
+    luma.assign(PADDED_WIDTH * PADDED_HEIGHT, 0);
+    scaled.assign(Width() * Height(), 0);
+    ghost.assign(SCREEN_WIDTH * SCREEN_HEIGHT, 0);
+}
+
+// Copia el frame con PAD pixeles de borde repetido, asi los kernels leen vecinos sin chequear limites
+void FrameFilter::Pad(const u8* frame) {
+    u8 luma_of[4];
+    for (int i = 0; i < 4; i++) luma_of[i] = Luma(palette.argb[i]) >> 3;   // 0-31: las sumas de xBR entran en u8
+
+    for (int y = 0; y < PADDED_HEIGHT; y++) {
+        int sy = std::max(0, std::min(y - PAD, SCREEN_HEIGHT - 1));
+        const u8* src = frame + sy * SCREEN_WIDTH;
+        u8* row = &padded[y * PADDED_WIDTH];
+        std::memset(row, src[0], PAD);
+        std::memcpy(row + PAD, src, SCREEN_WIDTH);
+        std::memset(row + PAD + SCREEN_WIDTH, src[SCREEN_WIDTH - 1], PAD);
+
+        u8* luma_row = &luma[y * PADDED_WIDTH];
+        for (int x = 0; x < PADDED_WIDTH; x++) luma_row[x] = luma_of[row[x] & 0x03];
+    }
+}
+
+void FrameFilter::Nearest(u32* dst, int pitch) {
+    u32 colors[16] = {palette.argb[0], palette.argb[1], palette.argb[2], palette.argb[3]};
+    u32 line[SCREEN_WIDTH];
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ExpandColors(&padded[(y + PAD) * PADDED_WIDTH + PAD], line, SCREEN_WIDTH, colors);
+        u32* out = dst + y * scale * pitch;
+
+        int x = 0;
+#if defined(__SSSE3__)
+        if (scale == 2) {
+            for (; x + 4 <= SCREEN_WIDTH; x += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(line + x));
+                _mm_storeu_si128((__m128i*)(out + x * 2), _mm_unpacklo_epi32(v, v));
+                _mm_storeu_si128((__m128i*)(out + x * 2 + 4), _mm_unpackhi_epi32(v, v));
+            }
+        }
+#endif
+        for (; x < SCREEN_WIDTH; x++) {
+            for (int k = 0; k < scale; k++) out[x * scale + k] = line[x];
+        }
+        for (int k = 1; k < scale; k++) std::memcpy(out + k * pitch, out, Width() * sizeof(u32));
+    }
+}
+
+// Scale2x (AdvMAME2x): E se parte en 4 y cada esquina copia al vecino si hay un borde
+//   B         E0 E1
+// D E F  ->   E2 E3
+//   H
+void FrameFilter::Scale2x(u32* dst, int pitch) {
+    const int out_width = SCREEN_WIDTH * 2;
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const u8* c = &padded[(y + PAD) * PADDED_WIDTH + PAD];
+        u8* row0 = &scaled[(y * 2) * out_width];
+        u8* row1 = row0 + out_width;
+
+        int x = 0;
+#if defined(__SSSE3__)
+        for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+            __m128i B = _mm_loadu_si128((const __m128i*)(c + x - PADDED_WIDTH));
+            __m128i D = _mm_loadu_si128((const __m128i*)(c + x - 1));
+            __m128i E = _mm_loadu_si128((const __m128i*)(c + x));
+            __m128i F = _mm_loadu_si128((const __m128i*)(c + x + 1));
+            __m128i H = _mm_loadu_si128((const __m128i*)(c + x + PADDED_WIDTH));
+            __m128i DB = _mm_cmpeq_epi8(D, B), BF = _mm_cmpeq_epi8(B, F);
+            __m128i DH = _mm_cmpeq_epi8(D, H), HF = _mm_cmpeq_epi8(H, F);
+
+            __m128i e0 = Select(_mm_andnot_si128(_mm_or_si128(BF, DH), DB), D, E);
+            __m128i e1 = Select(_mm_andnot_si128(_mm_or_si128(DB, HF), BF), F, E);
+            __m128i e2 = Select(_mm_andnot_si128(_mm_or_si128(DB, HF), DH), D, E);
+            __m128i e3 = Select(_mm_andnot_si128(_mm_or_si128(DH, BF), HF), F, E);
+
+            _mm_storeu_si128((__m128i*)(row0 + x * 2), _mm_unpacklo_epi8(e0, e1));
+            _mm_storeu_si128((__m128i*)(row0 + x * 2 + 16), _mm_unpackhi_epi8(e0, e1));
+            _mm_storeu_si128((__m128i*)(row1 + x * 2), _mm_unpacklo_epi8(e2, e3));
+            _mm_storeu_si128((__m128i*)(row1 + x * 2 + 16), _mm_unpackhi_epi8(e2, e3));
+        }
+#else
+        for (; x < SCREEN_WIDTH; x++) {
+            u8 B = c[x - PADDED_WIDTH], D = c[x - 1], E = c[x], F = c[x + 1], H = c[x + PADDED_WIDTH];
+            row0[x * 2]     = (D == B && B != F && D != H) ? D : E;
+            row0[x * 2 + 1] = (B == F && B != D && F != H) ? F : E;
+            row1[x * 2]     = (D == H && D != B && H != F) ? D : E;
+            row1[x * 2 + 1] = (H == F && D != H && B != F) ? F : E;
+        }
+#endif
+    }
+
+    u32 colors[16] = {palette.argb[0], palette.argb[1], palette.argb[2], palette.argb[3]};
+    for (int y = 0; y < Height(); y++) ExpandColors(&scaled[y * out_width], dst + y * pitch, out_width, colors);
+}
+
+// Scale3x (AdvMAME3x), mismas reglas extendidas a 3x3
+void FrameFilter::Scale3x(u32* dst, int pitch) {
+    const int out_width = SCREEN_WIDTH * 3;
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const u8* c = &padded[(y + PAD) * PADDED_WIDTH + PAD];
+        u8* rows[3] = {&scaled[(y * 3) * out_width], &scaled[(y * 3 + 1) * out_width], &scaled[(y * 3 + 2) * out_width]};
+
+        int x = 0;
+#if defined(__SSSE3__)
+        alignas(16) u8 parts[9][16];
+        for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+            const u8* p = c + x;
+            __m128i A = _mm_loadu_si128((const __m128i*)(p - PADDED_WIDTH - 1));
+            __m128i B = _mm_loadu_si128((const __m128i*)(p - PADDED_WIDTH));
+            __m128i C = _mm_loadu_si128((const __m128i*)(p - PADDED_WIDTH + 1));
+            __m128i D = _mm_loadu_si128((const __m128i*)(p - 1));
+            __m128i E = _mm_loadu_si128((const __m128i*)p);
+            __m128i F = _mm_loadu_si128((const __m128i*)(p + 1));
+            __m128i G = _mm_loadu_si128((const __m128i*)(p + PADDED_WIDTH - 1));
+            __m128i H = _mm_loadu_si128((const __m128i*)(p + PADDED_WIDTH));
+            __m128i I = _mm_loadu_si128((const __m128i*)(p + PADDED_WIDTH + 1));
+
+            __m128i active = Not(_mm_or_si128(_mm_cmpeq_epi8(B, H), _mm_cmpeq_epi8(D, F)));
+            __m128i DB = _mm_and_si128(active, _mm_cmpeq_epi8(D, B));
+            __m128i BF = _mm_and_si128(active, _mm_cmpeq_epi8(B, F));
+            __m128i DH = _mm_and_si128(active, _mm_cmpeq_epi8(D, H));
+            __m128i HF = _mm_and_si128(active, _mm_cmpeq_epi8(H, F));
+            __m128i nEA = Not(_mm_cmpeq_epi8(E, A)), nEC = Not(_mm_cmpeq_epi8(E, C));
+            __m128i nEG = Not(_mm_cmpeq_epi8(E, G)), nEI = Not(_mm_cmpeq_epi8(E, I));
+
+            __m128i out[9] = {
+                Select(DB, D, E),
+                Select(_mm_or_si128(_mm_and_si128(DB, nEC), _mm_and_si128(BF, nEA)), B, E),
+                Select(BF, F, E),
+                Select(_mm_or_si128(_mm_and_si128(DB, nEG), _mm_and_si128(DH, nEA)), D, E),
+                E,
+                Select(_mm_or_si128(_mm_and_si128(BF, nEI), _mm_and_si128(HF, nEC)), F, E),
+                Select(DH, D, E),
+                Select(_mm_or_si128(_mm_and_si128(DH, nEI), _mm_and_si128(HF, nEG)), H, E),
+                Select(HF, F, E),
+            };
+            for (int k = 0; k < 9; k++) _mm_store_si128((__m128i*)parts[k], out[k]);
+
+            for (int i = 0; i < 16; i++) {
+                for (int r = 0; r < 3; r++) {
+                    u8* o = rows[r] + (x + i) * 3;
+                    o[0] = parts[r * 3][i];
+                    o[1] = parts[r * 3 + 1][i];
+                    o[2] = parts[r * 3 + 2][i];
+                }
+            }
+        }
+#else
+        for (; x < SCREEN_WIDTH; x++) {
+            const u8* p = c + x;
+            u8 A = p[-PADDED_WIDTH - 1], B = p[-PADDED_WIDTH], C = p[-PADDED_WIDTH + 1];
+            u8 D = p[-1], E = p[0], F = p[1];
+            u8 G = p[PADDED_WIDTH - 1], H = p[PADDED_WIDTH], I = p[PADDED_WIDTH + 1];
+            u8 e[9] = {E, E, E, E, E, E, E, E, E};
+            if (B != H && D != F) {
+                if (D == B) e[0] = D;
+                if ((D == B && E != C) || (B == F && E != A)) e[1] = B;
+                if (B == F) e[2] = F;
+                if ((D == B && E != G) || (D == H && E != A)) e[3] = D;
+                if ((B == F && E != I) || (H == F && E != C)) e[5] = F;
+                if (D == H) e[6] = D;
+                if ((D == H && E != I) || (H == F && E != G)) e[7] = H;
+                if (H == F) e[8] = F;
+            }
+            for (int r = 0; r < 3; r++) std::memcpy(rows[r] + x * 3, e + r * 3, 3);
+        }
+#endif
+    }
+
+    u32 colors[16] = {palette.argb[0], palette.argb[1], palette.argb[2], palette.argb[3]};
+    for (int y = 0; y < Height(); y++) ExpandColors(&scaled[y * out_width], dst + y * pitch, out_width, colors);
+}
+
+// xBR nivel 1 a 2x. Para cada esquina de E compara el peso de las dos diagonales en un
+// entorno 5x5 (distancias de luminancia); si la que cruza E es mas "borde", esa esquina
+// se mezcla al 50% con el vecino mas parecido. El resultado se guarda como E*4 + vecino
+// (0-15) y se expande con una tabla de 16 colores ya mezclados.
+//       A1 B1 C1
+//    A0 A  B  C  C4
+//    D0 D  E  F  F4        (esquina de abajo a la derecha; las otras tres
+//    G0 G  H  I  I4         son la misma cuenta espejada)
+//       G5 H5 I5
+void FrameFilter::Xbr2x(u32* dst, int pitch) {
+    const int out_width = SCREEN_WIDTH * 2;
+    const int W = PADDED_WIDTH;
+
+    for (int corner = 0; corner < 4; corner++) {
+        int sx = (corner & 1) ? 1 : -1;
+        int sy = (corner & 2) ? 1 : -1;
+        auto at = [&](int dx, int dy) { return sy * dy * W + sx * dx; };
+        const int oB = at(0, -1), oC = at(1, -1), oD = at(-1, 0), oF = at(1, 0), oF4 = at(2, 0);
+        const int oG = at(-1, 1), oH = at(0, 1), oI = at(1, 1), oI4 = at(2, 1), oH5 = at(0, 2), oI5 = at(1, 2);
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            const u8* L = &luma[(y + PAD) * W + PAD];
+            const u8* P = &padded[(y + PAD) * W + PAD];
+            u8* out = &scaled[(y * 2 + (corner >> 1)) * out_width + (corner & 1)];
+
+            int x = 0;
+#if defined(__SSSE3__)
+            alignas(16) u8 result[16];
+            for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+                const u8* l = L + x;
+                auto load = [&](int offset) { return _mm_loadu_si128((const __m128i*)(l + offset)); };
+                __m128i E = load(0), B = load(oB), C = load(oC), D = load(oD), F = load(oF), F4 = load(oF4);
+                __m128i G = load(oG), H = load(oH), I = load(oI), I4 = load(oI4), H5 = load(oH5), I5 = load(oI5);
+
+                __m128i dHF = Distance(H, F), dEI = Distance(E, I);
+                __m128i dHF4 = _mm_adds_epu8(_mm_adds_epu8(dHF, dHF), _mm_adds_epu8(dHF, dHF));
+                __m128i dEI4 = _mm_adds_epu8(_mm_adds_epu8(dEI, dEI), _mm_adds_epu8(dEI, dEI));
+                __m128i across = _mm_adds_epu8(_mm_adds_epu8(Distance(E, C), Distance(E, G)),
+                                 _mm_adds_epu8(_mm_adds_epu8(Distance(I, H5), Distance(I, F4)), dHF4));
+                __m128i along = _mm_adds_epu8(_mm_adds_epu8(Distance(H, D), Distance(H, I5)),
+                                _mm_adds_epu8(_mm_adds_epu8(Distance(F, I4), Distance(F, B)), dEI4));
+                // across < along
+                __m128i edge = Not(_mm_cmpeq_epi8(_mm_max_epu8(across, along), across));
+
+                __m128i dEF = Distance(E, F), dEH = Distance(E, H);
+                __m128i prefer_f = _mm_cmpeq_epi8(_mm_min_epu8(dEF, dEH), dEF);
+
+                const u8* p = P + x;
+                __m128i Ei = _mm_loadu_si128((const __m128i*)p);
+                __m128i Fi = _mm_loadu_si128((const __m128i*)(p + oF));
+                __m128i Hi = _mm_loadu_si128((const __m128i*)(p + oH));
+                __m128i pick = Select(prefer_f, Fi, Hi);
+                __m128i apply = _mm_andnot_si128(_mm_cmpeq_epi8(pick, Ei), edge);
+                __m128i E4 = _mm_add_epi8(_mm_add_epi8(Ei, Ei), _mm_add_epi8(Ei, Ei));
+                _mm_store_si128((__m128i*)result, _mm_add_epi8(E4, Select(apply, pick, Ei)));
+
+                for (int i = 0; i < 16; i++) out[(x + i) * 2] = result[i];
+            }
+#else
+            for (; x < SCREEN_WIDTH; x++) {
+                const u8* l = L + x;
+                auto d = [](u8 a, u8 b) { return a > b ? a - b : b - a; };
+                int across = d(l[0], l[oC]) + d(l[0], l[oG]) + d(l[oI], l[oH5]) + d(l[oI], l[oF4]) + 4 * d(l[oH], l[oF]);
+                int along = d(l[oH], l[oD]) + d(l[oH], l[oI5]) + d(l[oF], l[oI4]) + d(l[oF], l[oB]) + 4 * d(l[0], l[oI]);
+                const u8* p = P + x;
+                u8 pick = d(l[0], l[oF]) <= d(l[0], l[oH]) ? p[oF] : p[oH];
+                bool apply = across < along && pick != p[0];
+                out[x * 2] = p[0] * 4 + (apply ? pick : p[0]);
+            }
+#endif
+        }
+    }
+
+    u32 colors[16];
+    for (int a = 0; a < 4; a++) {
+        for (int b = 0; b < 4; b++) colors[a * 4 + b] = Average(palette.argb[a], palette.argb[b]);
+    }
+    for (int y = 0; y < Height(); y++) ExpandColors(&scaled[y * out_width], dst + y * pitch, out_width, colors);
+}
+
+// LCD a 3x: cada pixel es un bloque 3x3 con la ultima fila y columna oscurecidas (la
+// separacion entre celdas) y el color se mezcla con el del frame anterior, como la
+// respuesta lenta del cristal del DMG
+void FrameFilter::Lcd3x(const u8* frame, u32* dst, int pitch) {
+    u32 colors[16] = {palette.argb[0], palette.argb[1], palette.argb[2], palette.argb[3]};
+    u32 line[SCREEN_WIDTH], dark[SCREEN_WIDTH];
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        u32* prev = &ghost[y * SCREEN_WIDTH];
+        ExpandColors(frame + y * SCREEN_WIDTH, line, SCREEN_WIDTH, colors);
+        if (!has_ghost) std::memcpy(prev, line, sizeof(line));
+
+        int x = 0;
+#if defined(__SSSE3__)
+        const __m128i quarter_mask = _mm_set1_epi8(0x3F);
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        for (; x + 4 <= SCREEN_WIDTH; x += 4) {
+            __m128i mixed = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(line + x)), _mm_loadu_si128((const __m128i*)(prev + x)));
+            __m128i shade = _mm_subs_epu8(mixed, _mm_and_si128(_mm_srli_epi16(mixed, 2), quarter_mask));
+            _mm_storeu_si128((__m128i*)(prev + x), mixed);
+            _mm_storeu_si128((__m128i*)(line + x), mixed);
+            _mm_storeu_si128((__m128i*)(dark + x), _mm_or_si128(shade, alpha));
+        }
+#endif
+        for (; x < SCREEN_WIDTH; x++) {
+            u32 mixed = Average(line[x], prev[x]);
+            u32 shade = 0xFF000000;
+            for (int shift = 0; shift < 24; shift += 8) {
+                u32 v = (mixed >> shift) & 0xFF;
+                shade |= (v - (v >> 2)) << shift;
+            }
+            prev[x] = line[x] = mixed;
+            dark[x] = shade;
+        }
+
+        u32* out0 = dst + (y * 3) * pitch;
+        u32* out2 = out0 + 2 * pitch;
+        for (x = 0; x < SCREEN_WIDTH; x++) {
+            out0[x * 3] = out0[x * 3 + 1] = line[x];
+            out0[x * 3 + 2] = dark[x];
+            out2[x * 3] = out2[x * 3 + 1] = out2[x * 3 + 2] = dark[x];
+        }
+        std::memcpy(out0 + pitch, out0, Width() * sizeof(u32));
+    }
+    has_ghost = true;
+}
+
+void FrameFilter::Apply(const u8* frame, u32* dst, int pitch) {
+    switch (type) {
+        case FILTER_NEAREST: Pad(frame); Nearest(dst, pitch); break;
+        case FILTER_SCALE2X: Pad(frame); Scale2x(dst, pitch); break;
+        case FILTER_SCALE3X: Pad(frame); Scale3x(dst, pitch); break;
+        case FILTER_XBR2X:   Pad(frame); Xbr2x(dst, pitch); break;
+        case FILTER_LCD3X:   Lcd3x(frame, dst, pitch); break;
+        default: break;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Video.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace CPU {
+    enum FilterType {
+        FILTER_NEAREST  = 0,    // Pixeles repetidos, escala configurable
+        FILTER_SCALE2X  = 1,
+        FILTER_SCALE3X  = 2,
+        FILTER_XBR2X    = 3,    // Bordes diagonales suavizados (xBR nivel 1)
+        FILTER_LCD3X    = 4,    // Grilla de LCD + fantasma del frame anterior
+        FILTER_COUNT
+    };
+
+    struct FilterInfo {
+        const char* name;
+        int scale;      // 0 = la elige el usuario (nearest)
+        bool temporal;  // Depende del frame anterior: hay que filtrar aunque no cambie
+    };
+    const FilterInfo& GetFilterInfo(FilterType type);
+    bool FindFilter(const std::string& name, FilterType& type);
+
+    // Escala un frame indexado (160x144) a ARGB8888. Los kernels trabajan sobre los
+    // indices con SSE (16 pixeles por vuelta) y expanden a color al final.
+    // Guarda estado entre frames (el fantasma del LCD), asi que es uno por salida.
+    class FrameFilter {
+        private:
+        FilterType type;
+        int scale;
+        Palette palette;
+        std::vector<u8> padded;         // Indices con 2 pixeles de borde repetido
+        std::vector<u8> luma;           // Luminancia / 8 de cada indice, mismo borde
+        std::vector<u8> scaled;         // Indices ya escalados (o combinados, en xBR)
+        std::vector<u32> ghost;         // LCD: color mostrado en el frame anterior
+        bool has_ghost = false;
+
+        void Pad(const u8* frame);
+        void Nearest(u32* dst, int pitch);
+        void Scale2x(u32* dst, int pitch);
+        void Scale3x(u32* dst, int pitch);
+        void Xbr2x(u32* dst, int pitch);
+        void Lcd3x(const u8* frame, u32* dst, int pitch);
+
+        public:
+        FrameFilter(FilterType type, int nearest_scale, const Palette& palette);
+
+        int Scale() const { return scale; }
+        int Width() const { return SCREEN_WIDTH * scale; }
+        int Height() const { return SCREEN_HEIGHT * scale; }
+        // 'pitch' en pixeles
+        void Apply(const u8* frame, u32* dst, int pitch);
+    };
+}
@@ -0,0 +1,195 @@
+#include "FramePipeline.hpp"
+#include <cstring>
+
+using namespace CPU;
+
+void EmuThread::Start() {
+    Stop();
+    quit = false;
+    credits = 1;
+    thread = std::thread(&EmuThread::Run, this);
+}
+
+void EmuThread::Stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void EmuThread::RequestFrame() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        credits = std::min(credits + 1, MAX_AHEAD);
+    }
+    wake.notify_one();
+}
+
+void EmuThread::ToggleDebug() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        debug = !debug;
+    }
+    wake.notify_one();
+}
+
+void EmuThread::Step() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        steps++;
+    }
+    wake.notify_one();
+}
+
+bool EmuThread::InDebug() {
+    std::lock_guard<std::mutex> guard(lock);
+    return debug;
+}
+
+void EmuThread::SetCapture(CaptureWriter* writer) {
+    capture = writer;
+    capture_audio.clear();
+    capture_audio.reserve(4096);
+    gb.audio_capture = writer ? &capture_audio : nullptr;
+}
+
+void EmuThread::PublishFrame(bool full_frame) {
+    PipelineFrame& frame = mailbox.Back();
+    frame.serial = gb.ppu.CopyFrame(frame.pixels);
+    frame.number = frame_number;
+    frame.emulated_at = std::chrono::steady_clock::now();
+
+    if (snapshots_enabled.load(std::memory_order_relaxed)) {
+        VideoSnapshot& snapshot = snapshots.Back();
+        const Memory_Bus& bus = gb.cpu.bus;
+        std::memcpy(snapshot.vram, bus.GetVRAM(), sizeof(snapshot.vram));
+        std::memcpy(snapshot.oam, bus.GetOAM(), sizeof(snapshot.oam));
+        snapshot.lcd = bus.GetLCD();
+        snapshots.Publish();
+    }
+
+    // Los pasos de debug no son frames: el audio se junta hasta el proximo frame completo
+    if (capture && full_frame) {
+        capture->Submit(frame.pixels, frame.serial, capture_audio);
+        capture_audio.clear();
+    }
+    mailbox.Publish();
+}
+
+void EmuThread::Run() {
+    while (true) {
+        bool step = false;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return quit || (debug ? steps > 0 : credits > 0); });
+            if (quit) return;
+            if (debug) {
+                steps--;
+                step = true;
+            } else {
+                credits--;
+            }
+        }
+
+        gb.SetJoypad(joypad.load(std::memory_order_relaxed));
+        gb.apu.SetRateAdjust(audio_ratio.load(std::memory_order_relaxed));
+
+        if (step) {
+            gb.StepInstruction();
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            bool running = gb.RunFrame();
+            emulate_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+            frame_number++;
+
+            if (!running) {
+                std::lock_guard<std::mutex> guard(lock);
+                debug = true;
+                std::cout << ">>> BREAKPOINT ALCANZADO: Salimos del bucle! <<<" << std::endl;
+            }
+        }
+        PublishFrame(!step);
+    }
+}
+
+void CPU::DrawIndexedFrame(SDL_Renderer* renderer, SDL_Texture* texture, const u8* frame, const Palette& palette) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) return;
+
+    ExpandFrame(frame, pixels, pitch, PIXEL_ARGB8888, palette);
+
+    SDL_UnlockTexture(texture);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+}
+
+FilterThread::FilterThread(FilterType type, int nearest_scale, const Palette& palette)
+    : filter(type, nearest_scale, palette) {
+    for (int i = 0; i < 3; i++) output.Slot(i).pixels.assign(filter.Width() * filter.Height(), 0);
+}
+
+void FilterThread::Start() {
+    Stop();
+    quit = false;
+    thread = std::thread(&FilterThread::Run, this);
+}
+
+void FilterThread::Stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void FilterThread::Submit(const PipelineFrame& frame) {
+    input.Back() = frame;
+    input.Publish();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = true;
+    }
+    wake.notify_one();
+}
+
+void FilterThread::Run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return quit || pending; });
+            if (quit) return;
+            pending = false;
+        }
+
+        const PipelineFrame* frame = input.TakeLatest();
+        if (!frame) continue;
+
+        auto start = std::chrono::steady_clock::now();
+        FilteredFrame& out = output.Back();
+        filter.Apply(frame->pixels, out.pixels.data(), filter.Width());
+        out.serial = frame->serial;
+        out.emulated_at = frame->emulated_at;
+        output.Publish();
+        filter_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    }
+}
+
+void CPU::DrawFilteredFrame(SDL_Renderer* renderer, SDL_Texture* texture, const FilteredFrame& frame, int width, int height) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) return;
+
+    for (int y = 0; y < height; y++) {
+        std::memcpy((u8*)pixels + y * pitch, frame.pixels.data() + y * width, width * sizeof(u32));
+    }
+
+    SDL_UnlockTexture(texture);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "GameBoy.hpp"
+#include "Filters.hpp"
+#include "Capture.hpp"
+#include "DebugViewers.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CPU {
+    // Frame que pasa del hilo de emulacion al presentador
+    struct PipelineFrame {
+        u8 pixels[160 * 144];
+        u32 serial = 0;     // FrameSerial de la PPU: igual al anterior = mismo contenido
+        u64 number = 0;     // Frames emulados hasta este
+        std::chrono::steady_clock::time_point emulated_at;
+    };
+
+    // Triple buffer sin locks: el productor llena 'back' y lo intercambia con el del medio;
+    // el consumidor intercambia el del medio con 'front'. Ninguno espera al otro.
+    template<typename T>
+    class TripleBuffer {
+        private:
+        static const u8 FRESH = 0x04;   // El del medio todavia no lo tomo el consumidor
+
+        T slots[3];
+        int back = 0;
+        int front = 2;
+        std::atomic<u8> middle{1};
+
+        public:
+        std::atomic<u64> published{0};
+        std::atomic<u64> dropped{0};    // Publicados que se pisaron antes de consumirse
+
+        // Antes de arrancar los hilos (p. ej. para dimensionar los buffers)
+        T& Slot(int index) { return slots[index]; }
+
+        // Productor
+        T& Back() { return slots[back]; }
+        void Publish() {
+            u8 previous = middle.exchange((u8)back | FRESH, std::memory_order_acq_rel);
+            if (previous & FRESH) dropped.fetch_add(1, std::memory_order_relaxed);
+            back = previous & 0x03;
+            published.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Consumidor: el nuevo, o nullptr si no llego otro desde la ultima vez
+        const T* TakeLatest() {
+            if (!(middle.load(std::memory_order_acquire) & FRESH)) return nullptr;
+            u8 previous = middle.exchange((u8)front, std::memory_order_acq_rel);
+            front = previous & 0x03;
+            return &slots[front];
+        }
+    };
+
+    using FrameMailbox = TripleBuffer<PipelineFrame>;
+
+    // Corre la GameBoy en su propio hilo. El ritmo lo pone el presentador: cada
+    // RequestFrame habilita un frame mas y el emulador nunca va mas de MAX_AHEAD adelante.
+    class EmuThread {
+        private:
+        static const int MAX_AHEAD = 2;
+
+        GameBoy& gb;
+        FrameMailbox mailbox;
+        std::thread thread;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        int credits = 0;
+        int steps = 0;
+        bool debug = false;
+        bool quit = false;
+
+        std::atomic<u8> joypad{0};
+        std::atomic<u64> emulate_ns{0};
+        std::atomic<double> audio_ratio{1.0};
+        u64 frame_number = 0;
+
+        TripleBuffer<VideoSnapshot> snapshots;
+        std::atomic<bool> snapshots_enabled{false};
+
+        CaptureWriter* capture = nullptr;
+        std::vector<float> capture_audio;   // Muestras del frame en curso
+
+        void Run();
+        void PublishFrame(bool full_frame);
+
+        public:
+        explicit EmuThread(GameBoy& machine) : gb(machine) {}
+        ~EmuThread() { Stop(); }
+
+        void Start();
+        void Stop();
+
+        // Graba cada frame emulado y su audio (antes de Start; nullptr = no grabar)
+        void SetCapture(CaptureWriter* writer);
+
+        // Presentador
+        void RequestFrame();
+        void SetJoypad(u8 mask) { joypad.store(mask, std::memory_order_relaxed); }
+        // Ratio de resampleo del APU (PacingController); se aplica antes de cada frame
+        void SetAudioRatio(double ratio) { audio_ratio.store(ratio, std::memory_order_relaxed); }
+        void ToggleDebug();
+        void Step();    // Una instruccion (modo debug)
+        bool InDebug();
+        FrameMailbox& Frames() { return mailbox; }
+        // VRAM/OAM/LCD de cada frame publicado, para los visores de debug
+        void EnableSnapshots(bool on) { snapshots_enabled.store(on, std::memory_order_relaxed); }
+        const VideoSnapshot* TakeSnapshot() { return snapshots.TakeLatest(); }
+        u64 TakeEmulateNanoseconds() { return emulate_ns.exchange(0); }
+    };
+
+    // Frame ya escalado por un FrameFilter, listo para subir a la textura
+    struct FilteredFrame {
+        std::vector<u32> pixels;
+        u32 serial = 0;
+        std::chrono::steady_clock::time_point emulated_at;
+    };
+
+    // Corre un FrameFilter en su propio hilo, fuera del de emulacion y del presentador.
+    // El presentador le pasa los frames nuevos con Submit y se lleva el ultimo filtrado;
+    // si el filtro no da abasto los frames intermedios se descartan.
+    class FilterThread {
+        private:
+        FrameFilter filter;
+        TripleBuffer<PipelineFrame> input;
+        TripleBuffer<FilteredFrame> output;
+        std::thread thread;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        bool pending = false;
+        bool quit = false;
+
+        std::atomic<u64> filter_ns{0};
+
+        void Run();
+
+        public:
+        FilterThread(FilterType type, int nearest_scale, const Palette& palette);
+        ~FilterThread() { Stop(); }
+
+        void Start();
+        void Stop();
+
+        int Width() const { return filter.Width(); }
+        int Height() const { return filter.Height(); }
+
+        void Submit(const PipelineFrame& frame);
+        const FilteredFrame* TakeLatest() { return output.TakeLatest(); }
+        u64 Filtered() const { return output.published; }
+        u64 TakeFilterNanoseconds() { return filter_ns.exchange(0); }
+    };
+
+    // Expande un frame indexado a la textura streaming y lo copia al renderer
+    void DrawIndexedFrame(SDL_Renderer* renderer, SDL_Texture* texture, const u8* frame, const Palette& palette);
+    // Copia un frame filtrado (ARGB8888) a la textura streaming y lo copia al renderer
+    void DrawFilteredFrame(SDL_Renderer* renderer, SDL_Texture* texture, const FilteredFrame& frame, int width, int height);
+}
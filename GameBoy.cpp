@@ -0,0 +1,161 @@
+#include "GameBoy.hpp"
+#include "RenderThread.hpp"
+#ifdef EMU_BUS_STATS
+#include "BusStats.hpp"
+#endif
+
+using namespace CPU;
+
+GameBoy::GameBoy(const GameBoy& other)
+    : cpu(other.cpu), ppu(other.ppu), apu(other.apu), audio_output(other.audio_output),
+      audio_capture(other.audio_capture), joypad_mask(other.joypad_mask) {
+    cpu.bus.SetAPU(&apu);
+}
+
+GameBoy& GameBoy::operator=(const GameBoy& other) {
+    cpu = other.cpu;
+    ppu = other.ppu;
+    apu = other.apu;
+    audio_output = other.audio_output;
+    audio_capture = other.audio_capture;
+    joypad_mask = other.joypad_mask;
+    cpu.bus.SetAPU(&apu);
+    return *this;
+}
+
+void GameBoy::Init() {
+    cpu.Init();
+}
+
+bool GameBoy::LoadROM(const char* path) {
+    return cpu.LoadROM(path);
+}
+
+void GameBoy::SetJoypad(u8 mask) {
+    u8 changed = mask ^ joypad_mask;
+    joypad_mask = mask;
+    for (int key = 0; key < 8; key++) {
+        if (changed & (1 << key)) cpu.UpdateJoypad(key, (mask >> key) & 1);
+    }
+}
+
+bool GameBoy::FrameEnded(u32 start_vblanks, int cycles_this_frame) const {
+    if (ppu.VBlankCount() != start_vblanks) return true;
+    bool lcd_on = (cpu.bus.GetLCD().LCDC & 0x80) != 0;
+    return cycles_this_frame >= (lcd_on ? 2 * CYCLES_PER_FRAME : CYCLES_PER_FRAME);
+}
+
+// Corta al entrar en VBlank, asi cada frame entregado es uno recien terminado. Con el
+// LCD apagado no hay VBlank y se corta a los CYCLES_PER_FRAME.
+bool GameBoy::RunFrame() {
+    int cycles_this_frame = 0;
+    u32 vblanks = ppu.VBlankCount();
+
+    while (true) {
+        cpu.HandleInterrupts();
+        int cycles = cpu.Step();
+        if (cycles == 0) return false;
+        cycles_this_frame += cycles;
+
+        ppu.Tick(cycles * 4, cpu.bus);
+        apu.Tick(cycles * 4, audio_output, audio_capture);
+
+        if (FrameEnded(vblanks, cycles_this_frame)) break;
+    }
+    apu.EndFrame(audio_output, audio_capture);
+#ifdef EMU_BUS_STATS
+    if (cpu.bus.GetStats()) cpu.bus.GetStats()->EndFrame();
+#endif
+    return true;
+}
+
+void GameBoy::StepInstruction() {
+    int cycles = cpu.Step();
+    if (cycles > 0) {
+        ppu.Tick(cycles * 4, cpu.bus);
+    }
+}
+
+void GameBoy::CloneFrom(const GameBoy& tmpl) {
+    AudioOutput* output = audio_output;
+    std::vector<float>* capture = audio_capture;
+    RenderThread* worker = ppu.GetRenderThread();
+    if (worker) worker->Stop();
+#ifdef EMU_PROFILER
+    Profiler* profiler = cpu.GetProfiler();
+#endif
+#ifdef EMU_BUS_STATS
+    BusStats* stats = cpu.bus.GetStats();
+#endif
+    *this = tmpl;
+    audio_output = output;
+    audio_capture = capture;
+#ifdef EMU_PROFILER
+    cpu.SetProfiler(profiler);
+#endif
+#ifdef EMU_BUS_STATS
+    cpu.bus.SetStats(stats);
+#endif
+    cpu.bus.ClearDirty();
+    ppu.SetRenderThread(nullptr);   // El de tmpl no es nuestro
+    SetRenderThread(worker);
+}
+
+void GameBoy::ResetTo(const GameBoy& tmpl) {
+    RenderThread* worker = ppu.GetRenderThread();
+    if (worker) worker->Stop();
+    cpu.RestoreFrom(tmpl.cpu);
+    cpu.bus.SetAPU(&apu);
+    ppu = tmpl.ppu;
+    apu = tmpl.apu;
+    joypad_mask = tmpl.joypad_mask;
+    ppu.SetRenderThread(nullptr);
+    if (worker) SetRenderThread(worker);
+}
+
+void GameBoy::SetRenderThread(RenderThread* worker) {
+    if (ppu.GetRenderThread()) ppu.GetRenderThread()->Stop();
+    ppu.SetRenderThread(nullptr);
+    cpu.bus.RecordVideoWrites(worker != nullptr);
+
+    if (worker) {
+        worker->Start(cpu.bus, ppu);
+        ppu.SetRenderThread(worker);
+    }
+}
+
+// "GBST" + version
+static const u32 STATE_MAGIC = 0x54534247;
+static const u32 STATE_VERSION = 8;
+
+void GameBoy::SaveState(std::vector<u8>& out) const {
+    out.clear();
+    StateWriter state{out};
+    state.Put(STATE_MAGIC);
+    state.Put(STATE_VERSION);
+    cpu.SaveState(state);
+    ppu.SaveState(state);
+    apu.SaveState(state);
+    state.Put(joypad_mask);
+}
+
+bool GameBoy::LoadState(const u8* data, size_t size) {
+    StateReader state{data, size};
+    u32 magic = 0, version = 0;
+    state.Get(magic);
+    state.Get(version);
+    if (!state.ok || magic != STATE_MAGIC || version != STATE_VERSION) return false;
+
+    // Se carga sobre una copia para no dejar la maquina a medias si el buffer esta mal
+    auto loaded = std::make_unique<GameBoy>(*this);
+    loaded->cpu.LoadState(state);
+    loaded->ppu.LoadState(state);
+    loaded->apu.LoadState(state);
+    state.Get(loaded->joypad_mask);
+    if (!state.ok) return false;
+
+    *this = *loaded;
+    // El espejo del render thread quedo viejo
+    if (ppu.GetRenderThread()) SetRenderThread(ppu.GetRenderThread());
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "CPU.hpp"
+#include "PPU.hpp"
+#include "APU.hpp"
+
+namespace CPU {
+    // 70224 clocks por frame / 4 = 17556 instrucciones (aprox)
+    const int CYCLES_PER_FRAME = 17556;
+
+    // Maquina completa: CPU + bus + PPU + APU, sin estado global.
+    class GameBoy {
+        public:
+        Processor cpu;
+        PPU ppu;
+        APU apu;
+        AudioOutput* audio_output = nullptr;            // Ring del callback de audio (nullptr = mudo)
+        std::vector<float>* audio_capture = nullptr;    // Recibe las muestras del APU (grabacion)
+        u8 joypad_mask = 0;
+
+        GameBoy() { cpu.bus.SetAPU(&apu); }
+        // Las copias conectan su bus a su propio APU, no al del original
+        GameBoy(const GameBoy& other);
+        GameBoy& operator=(const GameBoy& other);
+
+        void Init();
+        bool LoadROM(const char* path);
+        void SetROM(std::shared_ptr<const std::vector<u8>> data) { cpu.bus.SetROM(std::move(data)); }
+        void SetJoypad(u8 mask);    // bit i = tecla i de Memory_Bus::UpdateJoypad
+        bool RunFrame();        // Hasta el proximo VBlank; false si el CPU se detuvo (breakpoint / crash)
+        // Corte de RunFrame (tambien lo usa el lockstep): entro en VBlank desde start_vblanks,
+        // o paso un frame entero con el LCD apagado
+        bool FrameEnded(u32 start_vblanks, int cycles_this_frame) const;
+        void StepInstruction(); // Modo debug: una sola instruccion
+
+        // Template instances: 'tmpl' es una maquina ya booteada que no se vuelve a ejecutar.
+        // CloneFrom copia todo una vez (la ROM se comparte); ResetTo solo recopia las
+        // paginas de RAM que este worker ensucio desde el ultimo reset.
+        void CloneFrom(const GameBoy& tmpl);
+        void ResetTo(const GameBoy& tmpl);
+
+        // Save states: la ROM no se guarda, tiene que ser la misma al cargar
+        void SaveState(std::vector<u8>& out) const;
+        bool LoadState(const u8* data, size_t size);
+
+        // Render de scanlines en otro hilo (nullptr = inline). El worker sigue siendo de
+        // quien lo creo; CloneFrom/ResetTo/LoadState lo resincronizan con el estado nuevo.
+        void SetRenderThread(RenderThread* worker);
+    };
+}
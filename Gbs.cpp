@@ -0,0 +1,251 @@
+#include "Gbs.hpp"
+#include "AudioOutput.hpp"
+#include "Capture.hpp"
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace CPU;
+
+static constexpr u16 TRAP_ADDRESS = 0x0100;         // INIT/PLAY vuelven aca
+static constexpr u64 MACHINE_CLOCK = 1048576;       // Ciclos de maquina por segundo
+static constexpr u64 INIT_BUDGET = MACHINE_CLOCK * 5;
+
+static u16 ReadLE16(const std::vector<u8>& data, size_t offset) {
+    return data[offset] | (data[offset + 1] << 8);
+}
+
+static std::string ReadText(const std::vector<u8>& data, size_t offset) {
+    std::string text;
+    for (size_t i = offset; i < offset + 32 && data[i] != 0; i++) text += (char)data[i];
+    return text;
+}
+
+bool GbsPlayer::Load(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::vector<u8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return LoadData(data);
+}
+
+bool GbsPlayer::LoadData(const std::vector<u8>& file) {
+    if (file.size() <= 0x70 || file[0] != 'G' || file[1] != 'B' || file[2] != 'S') return false;
+    header.songs = file[0x04];
+    header.first_song = file[0x05];
+    header.load = ReadLE16(file, 0x06);
+    header.init = ReadLE16(file, 0x08);
+    header.play = ReadLE16(file, 0x0A);
+    header.stack = ReadLE16(file, 0x0C);
+    header.tma = file[0x0E];
+    header.tac = file[0x0F];
+    header.title = ReadText(file, 0x10);
+    header.author = ReadText(file, 0x30);
+    header.copyright = ReadText(file, 0x50);
+    if (header.songs == 0 || header.load < 0x0400 || header.load >= 0x8000) return false;
+
+    // ROM: el codigo en 'load' y el resto en bancos de 16 KB (el MBC los pagina igual)
+    size_t code_size = file.size() - 0x70;
+    size_t rom_size = std::max<size_t>(0x8000, (header.load + code_size + 0x3FFF) & ~size_t(0x3FFF));
+    auto rom = std::make_shared<std::vector<u8>>(rom_size, 0xFF);
+    std::copy(file.begin() + 0x70, file.end(), rom->begin() + header.load);
+    // RST n salta a load + n; las interrupciones vuelven sin hacer nada (IME queda apagado)
+    for (int i = 0; i < 8; i++) {
+        u16 target = header.load + i * 8;
+        (*rom)[i * 8] = 0xC3;
+        (*rom)[i * 8 + 1] = target & 0xFF;
+        (*rom)[i * 8 + 2] = target >> 8;
+    }
+    for (int vector = 0x40; vector <= 0x60; vector += 8) (*rom)[vector] = 0xD9;
+    (*rom)[TRAP_ADDRESS] = 0x18;        // JR -2: si algo salta a la trampa, se queda ahi
+    (*rom)[TRAP_ADDRESS + 1] = 0xFE;
+    (*rom)[0x0147] = 0x19;              // MBC5
+    (*rom)[0x0149] = 0x02;              // 8 KB de RAM externa, que muchos rips usan
+
+    base = std::make_unique<GameBoy>();
+    base->Init();
+    base->SetROM(rom);
+    base->cpu.bus.Write(0x0000, 0x0A);
+    base->cpu.bus.Write(0xFF06, header.tma);
+    base->cpu.bus.Write(0xFF07, header.tac & 0x07);
+    base->cpu.bus.SetIE(0);
+
+    if (header.tac & 0x04) {
+        static const u32 TAC_CYCLES[4] = {256, 4, 16, 64};
+        period = (256 - header.tma) * TAC_CYCLES[header.tac & 0x03];
+        if (header.tac & 0x80) period /= 2;     // Doble velocidad (GBC)
+    } else {
+        period = 70224 / 4;
+    }
+    gb.reset();
+    return true;
+}
+
+bool GbsPlayer::StartSong(int song) {
+    if (!base) return false;
+    gb = std::make_unique<GameBoy>(*base);
+    gb->apu.SetSampleRate(sample_rate);
+    clock = 0;
+    intro.clear();
+    bool ok = Call(header.init, (u8)song, INIT_BUDGET, intro);
+    next_play = clock;
+    return ok;
+}
+
+// Apila la trampa como direccion de retorno y corre hasta que el RET llega a ella
+bool GbsPlayer::Call(u16 address, u8 a, u64 budget, std::vector<float>& out) {
+    RegisterPair regs = gb->cpu.GetRegisters();
+    regs.A = a;
+    regs.SP = header.stack - 2;
+    regs.PC = address;
+    gb->cpu.SetRegisters(regs);
+    gb->cpu.SetHalted(false);
+    gb->cpu.bus.Write(regs.SP, TRAP_ADDRESS & 0xFF);
+    gb->cpu.bus.Write(regs.SP + 1, TRAP_ADDRESS >> 8);
+
+    u64 spent = 0;
+    bool returned = true;
+    while (gb->cpu.GetPC() != TRAP_ADDRESS) {
+        int cycles = spent < budget ? gb->cpu.Step() : 0;
+        if (cycles == 0) { returned = false; break; }
+        spent += cycles;
+        gb->apu.Tick(cycles * 4, nullptr, &out);
+        // Con IE en 0 nada lo despierta: un HALT es el final de la rutina
+        if (gb->cpu.IsHalted()) break;
+    }
+    clock += spent;
+    return returned;
+}
+
+// CPU quieto: solo corren el timer (de a 64 ciclos, uno de DIV por llamada) y el APU
+void GbsPlayer::Idle(u64 cycles, std::vector<float>& out) {
+    clock += cycles;
+    gb->apu.Tick((int)(cycles * 4), nullptr, &out);
+    while (cycles > 0) {
+        int step = (int)std::min<u64>(cycles, 64);
+        gb->cpu.bus.TickTimer(step);
+        cycles -= step;
+    }
+}
+
+void GbsPlayer::Render(double seconds, std::vector<float>& out) {
+    if (!gb) return;
+    out.insert(out.end(), intro.begin(), intro.end());
+    intro.clear();
+
+    u64 end = clock + (u64)(seconds * MACHINE_CLOCK);
+    while (clock < end) {
+        if (clock >= next_play) {
+            Call(header.play, gb->cpu.GetRegisters().A, period, out);
+            next_play = std::max(next_play + period, clock);
+            continue;
+        }
+        Idle(std::min(next_play, end) - clock, out);
+    }
+    gb->apu.EndFrame(nullptr, &out);
+}
+
+static std::string SongPath(const std::string& prefix, int song) {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%02d.wav", song + 1);
+    return prefix + suffix;
+}
+
+int CPU::RunGbsCommand(int argc, char* argv[]) {
+    const char* path = nullptr;
+    const char* wav_path = nullptr;
+    const char* all_prefix = nullptr;
+    int song = -1;
+    double seconds = -1.0;
+    int sample_rate = 44100;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--gbs" && i + 1 < argc) path = argv[++i];
+        else if (arg == "--song" && i + 1 < argc) song = std::atoi(argv[++i]) - 1;
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--wav" && i + 1 < argc) wav_path = argv[++i];
+        else if (arg == "--all" && i + 1 < argc) all_prefix = argv[++i];
+        else if (arg == "--sample-rate" && i + 1 < argc) sample_rate = std::max(8000, std::atoi(argv[++i]));
+    }
+    if (!path) {
+        std::cout << "Uso: --gbs <archivo.gbs> [--song N] [--seconds S] [--wav salida.wav | --all prefijo] [--sample-rate HZ]" << std::endl;
+        return 1;
+    }
+
+    GbsPlayer player;
+    if (!player.Load(path)) {
+        std::cout << "ERROR: No se pudo cargar el GBS." << std::endl;
+        return 1;
+    }
+    player.SetSampleRate(sample_rate);
+    const GbsHeader& header = player.Header();
+    std::cout << header.title << " - " << header.author << " (" << header.copyright << ")" << std::endl;
+    std::cout << (int)header.songs << " canciones, PLAY cada " << player.PlayPeriod() << " ciclos ("
+              << std::fixed << std::setprecision(2) << (double)MACHINE_CLOCK / player.PlayPeriod() << " Hz)" << std::endl;
+    if (song < 0 || song >= header.songs) song = std::max(0, header.first_song - 1);
+
+    // Sin ventana: las canciones se renderizan tan rapido como da el CPU
+    if (wav_path || all_prefix) {
+        if (seconds <= 0.0) seconds = 120.0;
+        int first = all_prefix ? 0 : song;
+        int last = all_prefix ? header.songs - 1 : song;
+        std::vector<float> samples;
+        double audio_seconds = 0.0, host_seconds = 0.0;
+        for (int s = first; s <= last; s++) {
+            samples.clear();
+            auto start = std::chrono::steady_clock::now();
+            if (!player.StartSong(s)) std::cout << "Cancion " << s + 1 << ": INIT no volvio" << std::endl;
+            player.Render(seconds, samples);
+            host_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            audio_seconds += (double)samples.size() / sample_rate;
+
+            std::string out_path = all_prefix ? SongPath(all_prefix, s) : std::string(wav_path);
+            if (!WriteWavFile(out_path, samples.data(), samples.size(), sample_rate)) {
+                std::cout << "ERROR: No se pudo escribir " << out_path << std::endl;
+                return 1;
+            }
+            std::cout << out_path << ": " << samples.size() << " muestras" << std::endl;
+        }
+        std::cout << std::setprecision(1) << audio_seconds << " s de audio en " << std::setprecision(3) << host_seconds
+                  << " s (" << std::setprecision(0) << audio_seconds / std::max(host_seconds, 1e-9) << "x tiempo real)" << std::endl;
+        return 0;
+    }
+
+    // En vivo: solo el subsistema de audio; Ctrl+C llega como SDL_QUIT
+    if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_EVENTS) < 0) {
+        std::cout << "ERROR: SDL_Init: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    AudioOutput audio;
+    if (!audio.Open(sample_rate, 60)) {
+        std::cout << "ERROR: No se pudo abrir el audio." << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+    if (!player.StartSong(song)) std::cout << "Cancion " << song + 1 << ": INIT no volvio" << std::endl;
+    std::cout << "Cancion " << song + 1 << "/" << (int)header.songs << std::endl;
+
+    std::vector<float> chunk;
+    double played = 0.0;
+    bool running = true;
+    while (running && (seconds <= 0.0 || played < seconds)) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) running = false;
+        }
+        if (!audio.NeedsAudio()) {
+            SDL_Delay(2);
+            continue;
+        }
+        chunk.clear();
+        player.Render(1.0 / 60.0, chunk);
+        audio.Push(chunk.data(), chunk.size());
+        played += 1.0 / 60.0;
+    }
+    audio.Close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "GameBoy.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CPU {
+    // Encabezado de un rip GBS (0x70 bytes, little endian)
+    struct GbsHeader {
+        u8 songs = 0;
+        u8 first_song = 1;      // 1-based
+        u16 load = 0;           // Donde va el codigo en el espacio de ROM
+        u16 init = 0;           // INIT: A = cancion (0-based)
+        u16 play = 0;           // PLAY: una vez por periodo
+        u16 stack = 0;
+        u8 tma = 0;
+        u8 tac = 0;             // Bit 2 en 1: PLAY va al ritmo del timer; si no, a 59.7 Hz
+        std::string title, author, copyright;
+    };
+
+    // Reproductor de GBS: solo CPU, timer y APU, sin PPU ni ventana. El codigo se copia a
+    // una ROM armada en memoria (RST apuntando a load + n, como pide el formato) y INIT/PLAY
+    // se llaman directamente: se apila una direccion trampa y se corre hasta volver a ella
+    // (o hasta un HALT, que sin interrupciones no terminaria nunca).
+    // Entre dos PLAY el CPU queda quieto y solo avanzan el timer y el APU.
+    class GbsPlayer {
+        private:
+        GbsHeader header;
+        std::unique_ptr<GameBoy> base;      // Recien cargado, antes de INIT
+        std::unique_ptr<GameBoy> gb;
+        u32 period = 17556;     // Ciclos de maquina entre dos PLAY
+        u64 clock = 0;          // Ciclos de maquina desde StartSong
+        u64 next_play = 0;
+        int sample_rate = 44100;
+        std::vector<float> intro;           // Lo que sono durante INIT, sale con el primer Render
+
+        bool Call(u16 address, u8 a, u64 budget, std::vector<float>& out);
+        void Idle(u64 cycles, std::vector<float>& out);
+
+        public:
+        bool Load(const char* path);
+        bool LoadData(const std::vector<u8>& file);
+        const GbsHeader& Header() const { return header; }
+        // Ciclos de maquina por segundo de audio y entre llamadas a PLAY
+        u32 PlayPeriod() const { return period; }
+        void SetSampleRate(int rate) { sample_rate = rate; }
+
+        // song es 0-based; false si INIT no vuelve
+        bool StartSong(int song);
+        // Avanza 'seconds' de musica y agrega las muestras a 'out'
+        void Render(double seconds, std::vector<float>& out);
+    };
+
+    // --gbs <archivo.gbs> [--song N] [--seconds S] [--wav salida.wav | --all prefijo] [--sample-rate HZ]
+    // Sin --wav/--all suena en vivo (solo audio). --all renderiza todas las canciones a
+    // prefijo_NN.wav y muestra la velocidad contra tiempo real.
+    int RunGbsCommand(int argc, char* argv[]);
+}
@@ -0,0 +1,381 @@
+#include "Lockstep.hpp"
+#include <chrono>
+#include <iomanip>
+#include <string>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace CPU;
+
+// Opcodes que tienen kernel vectorial: solo registros, o un inmediato que se junta por lane
+static bool HasKernel(u8 op) {
+    if (op >= 0x40 && op < 0xC0) return (op & 0x07) != 6 && (op < 0x80 ? ((op >> 3) & 0x07) != 6 : true);
+    if ((op & 0xC6) == 0x04) return ((op >> 3) & 0x07) != 6;   // INC r / DEC r
+    if ((op & 0xC7) == 0x06) return ((op >> 3) & 0x07) != 6;   // LD r, d8
+    if ((op & 0xC7) == 0xC6) return true;                      // ALU A, d8
+    if (op == 0x18 || op == 0x20 || op == 0x28 || op == 0x30 || op == 0x38) return true;   // JR
+    return false;
+}
+
+static void ExpandMask(u16 lanes, u8* mask) {
+    for (int i = 0; i < LOCKSTEP_LANES; i++) mask[i] = (lanes >> i) & 1 ? 0xFF : 0x00;
+}
+
+// LD dst, src
+static void LoadKernel(u8* dst, const u8* src, const u8* mask) {
+#if defined(__AVX2__)
+    __m128i m = _mm_load_si128((const __m128i*)mask);
+    __m128i d = _mm_load_si128((const __m128i*)dst);
+    __m128i s = _mm_load_si128((const __m128i*)src);
+    _mm_store_si128((__m128i*)dst, _mm_blendv_epi8(d, s, m));
+#else
+    for (int i = 0; i < LOCKSTEP_LANES; i++) if (mask[i]) dst[i] = src[i];
+#endif
+}
+
+// INC r / DEC r: Z, N, H; C se conserva
+static void IncDecKernel(u8* r, u8* F, bool dec, const u8* mask) {
+#if defined(__AVX2__)
+    __m128i m = _mm_load_si128((const __m128i*)mask);
+    __m128i v = _mm_load_si128((const __m128i*)r);
+    __m128i f = _mm_load_si128((const __m128i*)F);
+    __m128i nib = _mm_set1_epi8(0x0F);
+    __m128i h = _mm_cmpeq_epi8(_mm_and_si128(v, nib), dec ? _mm_setzero_si128() : nib);
+    __m128i res = dec ? _mm_sub_epi8(v, _mm_set1_epi8(1)) : _mm_add_epi8(v, _mm_set1_epi8(1));
+    __m128i z = _mm_cmpeq_epi8(res, _mm_setzero_si128());
+    __m128i flags = _mm_or_si128(_mm_and_si128(f, _mm_set1_epi8(0x1F)),
+                    _mm_or_si128(_mm_and_si128(z, _mm_set1_epi8((char)0x80)),
+                    _mm_or_si128(_mm_and_si128(h, _mm_set1_epi8(0x20)), _mm_set1_epi8(dec ? 0x40 : 0x00))));
+    _mm_store_si128((__m128i*)r, _mm_blendv_epi8(v, res, m));
+    _mm_store_si128((__m128i*)F, _mm_blendv_epi8(f, flags, m));
+#else
+    for (int i = 0; i < LOCKSTEP_LANES; i++) {
+        if (!mask[i]) continue;
+        bool h = dec ? (r[i] & 0x0F) == 0x00 : (r[i] & 0x0F) == 0x0F;
+        r[i] = dec ? r[i] - 1 : r[i] + 1;
+        F[i] = (F[i] & 0x1F) | (r[i] == 0 ? 0x80 : 0) | (dec ? 0x40 : 0) | (h ? 0x20 : 0);
+    }
+#endif
+}
+
+// ADD ADC SUB SBC AND XOR OR CP sobre A, con los mismos flags que Command
+static void AluKernel(int alu, u8* A, u8* F, const u8* src, const u8* mask) {
+#if defined(__AVX2__)
+    // 16 lanes ensanchados a 16 bits: el carry queda en el bit 8
+    __m256i a = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)A));
+    __m256i s = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)src));
+    __m256i f = _mm256_cvtepu8_epi16(_mm_load_si128((const __m128i*)F));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i nib = _mm256_set1_epi16(0x0F);
+    const __m256i byte = _mm256_set1_epi16(0xFF);
+    __m256i carry = _mm256_and_si256(_mm256_srli_epi16(f, 4), _mm256_set1_epi16(1));
+    __m256i res, h, c, n = zero;
+
+    switch (alu) {
+        case 0: case 1: {
+            __m256i cin = (alu == 1) ? carry : zero;
+            res = _mm256_add_epi16(_mm256_add_epi16(a, s), cin);
+            h = _mm256_cmpgt_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a, nib), _mm256_and_si256(s, nib)), cin), nib);
+            c = _mm256_cmpgt_epi16(res, byte);
+            break;
+        }
+        case 2: case 3: case 7: {
+            __m256i cin = (alu == 3) ? carry : zero;
+            res = _mm256_sub_epi16(_mm256_sub_epi16(a, s), cin);
+            h = _mm256_cmpgt_epi16(zero, _mm256_sub_epi16(_mm256_sub_epi16(_mm256_and_si256(a, nib), _mm256_and_si256(s, nib)), cin));
+            c = _mm256_cmpgt_epi16(zero, res);
+            n = _mm256_set1_epi16(-1);
+            break;
+        }
+        case 4: res = _mm256_and_si256(a, s); h = _mm256_set1_epi16(-1); c = zero; break;
+        case 5: res = _mm256_xor_si256(a, s); h = zero; c = zero; break;
+        default: res = _mm256_or_si256(a, s); h = zero; c = zero; break;
+    }
+    res = _mm256_and_si256(res, byte);
+    __m256i z = _mm256_cmpeq_epi16(res, zero);
+    __m256i flags = _mm256_or_si256(_mm256_and_si256(f, nib),
+                    _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(z, _mm256_set1_epi16(0x80)), _mm256_and_si256(n, _mm256_set1_epi16(0x40))),
+                                    _mm256_or_si256(_mm256_and_si256(h, _mm256_set1_epi16(0x20)), _mm256_and_si256(c, _mm256_set1_epi16(0x10)))));
+
+    __m128i m = _mm_load_si128((const __m128i*)mask);
+    __m128i res8 = _mm_packus_epi16(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1));
+    __m128i flags8 = _mm_packus_epi16(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+    if (alu != 7) _mm_store_si128((__m128i*)A, _mm_blendv_epi8(_mm_load_si128((const __m128i*)A), res8, m));
+    _mm_store_si128((__m128i*)F, _mm_blendv_epi8(_mm_load_si128((const __m128i*)F), flags8, m));
+#else
+    for (int i = 0; i < LOCKSTEP_LANES; i++) {
+        if (!mask[i]) continue;
+        int a = A[i], s = src[i], cin = (F[i] >> 4) & 1;
+        int res;
+        bool h, c, n = false;
+        switch (alu) {
+            case 0: case 1:
+                if (alu == 0) cin = 0;
+                res = a + s + cin;
+                h = ((a & 0x0F) + (s & 0x0F) + cin) > 0x0F;
+                c = res > 0xFF;
+                break;
+            case 2: case 3: case 7:
+                if (alu != 3) cin = 0;
+                res = a - s - cin;
+                h = ((a & 0x0F) - (s & 0x0F) - cin) < 0;
+                c = res < 0;
+                n = true;
+                break;
+            case 4: res = a & s; h = true; c = false; break;
+            case 5: res = a ^ s; h = false; c = false; break;
+            default: res = a | s; h = false; c = false; break;
+        }
+        res &= 0xFF;
+        F[i] = (F[i] & 0x0F) | (res == 0 ? 0x80 : 0) | (n ? 0x40 : 0) | (h ? 0x20 : 0) | (c ? 0x10 : 0);
+        if (alu != 7) A[i] = (u8)res;
+    }
+#endif
+}
+
+void LockstepCore::Init(const GameBoy& tmpl, int count) {
+    lane_count = std::min(count, LOCKSTEP_LANES);
+    lanes.assign(lane_count, tmpl);
+    running = (u16)((1u << lane_count) - 1);
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+        for (int r = 0; r < 8; r++) regs.r8[r][lane] = 0;
+        regs.SP[lane] = 0;
+        regs.PC[lane] = 0;
+    }
+    for (int lane = 0; lane < lane_count; lane++) StoreLane(lane);
+}
+
+void LockstepCore::LoadLane(int lane) {
+    RegisterPair r = lanes[lane].cpu.GetRegisters();
+    r.B = regs.r8[0][lane]; r.C = regs.r8[1][lane];
+    r.D = regs.r8[2][lane]; r.E = regs.r8[3][lane];
+    r.H = regs.r8[4][lane]; r.L = regs.r8[5][lane];
+    r.F = regs.r8[6][lane]; r.A = regs.r8[7][lane];
+    r.SP = regs.SP[lane];
+    r.PC = regs.PC[lane];
+    lanes[lane].cpu.SetRegisters(r);
+}
+
+void LockstepCore::StoreLane(int lane) {
+    const RegisterPair& r = lanes[lane].cpu.GetRegisters();
+    regs.r8[0][lane] = r.B; regs.r8[1][lane] = r.C;
+    regs.r8[2][lane] = r.D; regs.r8[3][lane] = r.E;
+    regs.r8[4][lane] = r.H; regs.r8[5][lane] = r.L;
+    regs.r8[6][lane] = r.F; regs.r8[7][lane] = r.A;
+    regs.SP[lane] = r.SP;
+    regs.PC[lane] = r.PC;
+}
+
+void LockstepCore::Sync() {
+    for (int lane = 0; lane < lane_count; lane++) LoadLane(lane);
+}
+
+// Lo que no sea una instruccion de registros "normal" (HALT, interrupciones,
+// PC en zonas que Step marca como crash) lo resuelve el Processor del lane
+bool LockstepCore::FastPathAllowed(int lane) {
+    Processor& cpu = lanes[lane].cpu;
+    if (cpu.IsHalted()) return false;
+
+    u16 pc = regs.PC[lane];
+    if ((pc >= 0x8000 && pc < 0xA000) || (pc >= 0xFF00 && pc < 0xFF80)) return false;
+
+    if (cpu.GetIME() && (cpu.bus.Read(0xFF0F) & cpu.bus.Read(0xFFFF) & 0x1F)) return false;
+    return true;
+}
+
+int LockstepCore::ScalarStep(int lane) {
+    LoadLane(lane);
+    lanes[lane].cpu.HandleInterrupts();
+    int cycles = lanes[lane].cpu.Step();
+    StoreLane(lane);
+    return cycles;
+}
+
+void LockstepCore::Step(u16 active, int* cycles) {
+    u16 groups[256] = {};
+    u8 opcodes[LOCKSTEP_LANES];
+    int distinct = 0;
+    u16 scalar = 0;
+
+    // Reagrupar por opcode: lanes con PC distinto pero el mismo opcode van juntos
+    for (int lane = 0; lane < lane_count; lane++) {
+        u16 bit = 1 << lane;
+        if (!(active & bit)) continue;
+
+        if (!FastPathAllowed(lane)) { scalar |= bit; continue; }
+        u8 op = lanes[lane].cpu.bus.Read(regs.PC[lane]);
+        if (!HasKernel(op)) { scalar |= bit; continue; }
+
+        if (groups[op] == 0) opcodes[distinct++] = op;
+        groups[op] |= bit;
+    }
+
+    alignas(16) u8 mask[LOCKSTEP_LANES];
+    for (int g = 0; g < distinct; g++) {
+        u8 op = opcodes[g];
+        u16 lanes_in_group = groups[op];
+        ExpandMask(lanes_in_group, mask);
+
+        // Inmediato de cada lane (cada uno lee de su propio bus)
+        bool is_jr = op < 0x40 && (op & 0x07) == 0x00;
+        bool has_imm = is_jr || (op & 0xC7) == 0x06 || (op & 0xC7) == 0xC6;
+        alignas(16) u8 imm[LOCKSTEP_LANES] = {};
+        if (has_imm) {
+            for (u16 m = lanes_in_group; m; m &= m - 1) {
+                int lane = __builtin_ctz(m);
+                imm[lane] = lanes[lane].cpu.bus.Read(regs.PC[lane] + 1);
+            }
+        }
+
+        alignas(16) u8 taken[LOCKSTEP_LANES] = {};
+        if (op >= 0xC0) {
+            AluKernel((op >> 3) & 0x07, regs.r8[7], regs.r8[6], imm, mask);
+        } else if (op >= 0x80) {
+            AluKernel((op >> 3) & 0x07, regs.r8[7], regs.r8[6], regs.r8[op & 0x07], mask);
+        } else if (op >= 0x40) {
+            LoadKernel(regs.r8[(op >> 3) & 0x07], regs.r8[op & 0x07], mask);
+        } else if ((op & 0x07) == 0x06) {
+            LoadKernel(regs.r8[(op >> 3) & 0x07], imm, mask);
+        } else if (is_jr) {
+            // 0x18 siempre; 0x20 NZ, 0x28 Z, 0x30 NC, 0x38 C
+            const u8* F = regs.r8[6];
+            u8 flag = (op & 0x10) ? 0x10 : 0x80;
+            bool want = (op & 0x08) != 0;
+            for (int i = 0; i < LOCKSTEP_LANES; i++) {
+                bool cond = op == 0x18 || ((F[i] & flag) != 0) == want;
+                taken[i] = cond ? mask[i] : 0x00;
+                regs.PC[i] += taken[i] ? (s8)imm[i] : 0;
+            }
+        } else {
+            IncDecKernel(regs.r8[(op >> 3) & 0x07], regs.r8[6], op & 0x01, mask);
+        }
+
+        int length = has_imm ? 2 : 1;
+        for (u16 m = lanes_in_group; m; m &= m - 1) {
+            int lane = __builtin_ctz(m);
+            int c = length + (taken[lane] ? 1 : 0);
+            regs.PC[lane] += length;
+            lanes[lane].cpu.bus.TickTimer(c);
+            cycles[lane] = c;
+        }
+        vector_steps += __builtin_popcount(lanes_in_group);
+    }
+
+    for (u16 m = scalar; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        cycles[lane] = ScalarStep(lane);
+        scalar_steps++;
+    }
+}
+
+void LockstepCore::RunFrame() {
+    int frame_cycles[LOCKSTEP_LANES] = {};
+    int cycles[LOCKSTEP_LANES] = {};
+    u32 vblanks[LOCKSTEP_LANES] = {};
+    u16 active = running;
+    for (u16 m = active; m; m &= m - 1) {
+        int lane = __builtin_ctz(m);
+        vblanks[lane] = lanes[lane].ppu.VBlankCount();
+    }
+
+    while (active) {
+        Step(active, cycles);
+
+        for (u16 m = active; m; m &= m - 1) {
+            int lane = __builtin_ctz(m);
+            u16 bit = 1 << lane;
+            GameBoy& gb = lanes[lane];
+
+            if (cycles[lane] == 0) {
+                running &= ~bit;
+                active &= ~bit;
+                continue;
+            }
+            frame_cycles[lane] += cycles[lane];
+            gb.ppu.Tick(cycles[lane] * 4, gb.cpu.bus);
+            gb.apu.Tick(cycles[lane] * 4, gb.audio_output, gb.audio_capture);
+
+            if (gb.FrameEnded(vblanks[lane], frame_cycles[lane])) {
+                gb.apu.EndFrame(gb.audio_output, gb.audio_capture);
+                active &= ~bit;
+            }
+        }
+    }
+}
+
+static u64 HashLane(GameBoy& gb) {
+    u64 hash = 1469598103934665603ull;
+    auto mix = [&](const void* data, size_t size) {
+        const u8* bytes = (const u8*)data;
+        for (size_t i = 0; i < size; i++) { hash ^= bytes[i]; hash *= 1099511628211ull; }
+    };
+    RegisterPair r = gb.cpu.GetRegisters();
+    mix(&r, sizeof(r));
+    mix(gb.ppu.GetFrame(), 160 * 144);
+    return hash;
+}
+
+int CPU::RunLockstepCommand(int argc, char* argv[]) {
+    const char* rom = nullptr;
+    int lane_count = LOCKSTEP_LANES;
+    int frames = 300;
+    int warmup = 60;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--lockstep" && i + 1 < argc) rom = argv[++i];
+        else if (arg == "--lanes" && i + 1 < argc) lane_count = std::atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc) frames = std::atoi(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < argc) warmup = std::atoi(argv[++i]);
+    }
+    lane_count = std::max(1, std::min(lane_count, LOCKSTEP_LANES));
+
+    GameBoy tmpl;
+    tmpl.Init();
+    if (!rom || !tmpl.LoadROM(rom)) {
+        std::cout << "ERROR: No se pudo cargar la ROM." << std::endl;
+        return -1;
+    }
+    for (int i = 0; i < warmup; i++) tmpl.RunFrame();
+
+    // Cada lane con una entrada distinta, como agentes independientes
+    std::vector<GameBoy> scalar(lane_count, tmpl);
+    for (int lane = 0; lane < lane_count; lane++) scalar[lane].SetJoypad((u8)lane);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int lane = 0; lane < lane_count; lane++) {
+        for (int f = 0; f < frames; f++) scalar[lane].RunFrame();
+    }
+    double scalar_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    LockstepCore core;
+    core.Init(tmpl, lane_count);
+    for (int lane = 0; lane < lane_count; lane++) core.Lane(lane).SetJoypad((u8)lane);
+
+    start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) core.RunFrame();
+    double lockstep_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    core.Sync();
+
+    int mismatches = 0;
+    for (int lane = 0; lane < lane_count; lane++) {
+        if (HashLane(scalar[lane]) != HashLane(core.Lane(lane))) mismatches++;
+    }
+
+    long long steps = core.vector_steps + core.scalar_steps;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "Lanes: " << lane_count << " | Frames: " << frames << " | Instrucciones: " << steps << std::endl;
+#if defined(__AVX2__)
+    std::cout << "Kernels: AVX2" << std::endl;
+#else
+    std::cout << "Kernels: escalares (compilar con -mavx2 para AVX2)" << std::endl;
+#endif
+    std::cout << "Escalar x" << lane_count << ": " << steps / scalar_seconds << " steps/s por core" << std::endl;
+    std::cout << "Lockstep:   " << steps / lockstep_seconds << " steps/s por core" << std::endl;
+    std::cout << std::setprecision(2);
+    std::cout << "Speedup: " << scalar_seconds / lockstep_seconds << "x | Por kernel: "
+              << (steps > 0 ? 100.0 * core.vector_steps / steps : 0.0) << "% de los steps" << std::endl;
+    std::cout << "Lanes distintos del escalar: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
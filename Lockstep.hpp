@@ -0,0 +1,47 @@
+#pragma once
+#include "GameBoy.hpp"
+#include <vector>
+
+namespace CPU {
+    const int LOCKSTEP_LANES = 16;
+
+    // Registros en structure-of-arrays: una fila por registro, una columna por instancia.
+    // Las filas de 8 bits usan el codigo de registro del opcode (0=B 1=C 2=D 3=E 4=H 5=L 7=A);
+    // la fila 6, que en el opcode es (HL), guarda F.
+    struct LaneRegisters {
+        alignas(32) u8 r8[8][LOCKSTEP_LANES];
+        alignas(32) u16 SP[LOCKSTEP_LANES];
+        alignas(32) u16 PC[LOCKSTEP_LANES];
+    };
+
+    // Ejecuta hasta 16 instancias de la misma ROM instruccion por instruccion.
+    // Los lanes que estan en el mismo opcode (LD r,r / LD r,d8 / ALU A,r / ALU A,d8 /
+    // INC r / DEC r / JR) pasan juntos por un kernel vectorial con mascara; los lanes con
+    // PC distinto se reagrupan por opcode y el resto cae al Processor escalar del lane.
+    class LockstepCore {
+        private:
+        LaneRegisters regs;
+        std::vector<GameBoy> lanes;
+        int lane_count = 0;
+        u16 running = 0;    // Mascara de lanes vivos
+
+        void LoadLane(int lane);    // SoA -> Processor
+        void StoreLane(int lane);   // Processor -> SoA
+        bool FastPathAllowed(int lane);
+        int ScalarStep(int lane);
+
+        public:
+        long long vector_steps = 0;     // Instrucciones de lane resueltas por kernel
+        long long scalar_steps = 0;
+
+        void Init(const GameBoy& tmpl, int count);
+        void Step(u16 active, int* cycles);
+        void RunFrame();
+        void Sync();    // Copia los registros SoA de vuelta a cada GameBoy
+        GameBoy& Lane(int lane) { return lanes[lane]; }
+        int LaneCount() const { return lane_count; }
+    };
+
+    // --lockstep <rom> [--lanes N] [--frames F] [--warmup W]
+    int RunLockstepCommand(int argc, char* argv[]);
+}
@@ -1,15 +1,61 @@
 #include <iostream>
 #include <fstream>
-#include "CPU.hpp"
-#include "PPU.hpp"
+#include "GameBoy.hpp"
+#include "Batch.hpp"
+#include "Lockstep.hpp"
+#include "Bench.hpp"
+#include "Gbs.hpp"
+#include "RenderThread.hpp"
+#include "FramePipeline.hpp"
+#include "AudioOutput.hpp"
+#include "Pacing.hpp"
 #include <SDL2/SDL.h>
-#include "APU.hpp"
-
-const int SCALE = 3;
-// 70224 clocks por frame / 4 = 17556 instrucciones (aprox)
-const int CYCLES_PER_FRAME = 17556;
+#include <algorithm>
 
 int main(int argc, char* argv[]) {
+	// Modo batch: sin ventana ni audio
+	if (argc > 1 && std::string(argv[1]) == "--batch") {
+		return CPU::RunBatchCommand(argc, argv);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--lockstep") {
+		return CPU::RunLockstepCommand(argc, argv);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--bench") {
+		return CPU::RunBenchCommand(argc, argv);
+	}
+	// Musica GBS: solo audio, sin PPU ni ventana
+	if (argc > 1 && std::string(argv[1]) == "--gbs") {
+		return CPU::RunGbsCommand(argc, argv);
+	}
+
+	const char* rom_path = nullptr;
+	int scale = 3;
+	bool show_stats = false;
+	bool render_thread = false;
+	CPU::Palette palette = CPU::PALETTE_GRAY;
+	bool use_filter = false;
+	const char* capture_path = nullptr;
+	int sample_rate = 44100;
+	int audio_latency_ms = 40;
+	CPU::FilterType filter_type = CPU::FILTER_NEAREST;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--scale" && i + 1 < argc) scale = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--stats") show_stats = true;
+		else if (arg == "--render-thread") render_thread = true;
+		else if (arg == "--capture" && i + 1 < argc) capture_path = argv[++i];
+		else if (arg == "--audio-latency" && i + 1 < argc) audio_latency_ms = std::max(5, std::min(std::atoi(argv[++i]), 250));
+		else if (arg == "--sample-rate" && i + 1 < argc) sample_rate = std::max(8000, std::min(std::atoi(argv[++i]), 192000));
+		else if (arg == "--palette" && i + 1 < argc) {
+			if (!CPU::FindPalette(argv[++i], palette)) std::cout << "Paleta desconocida, uso gray." << std::endl;
+		}
+		else if (arg == "--filter" && i + 1 < argc) {
+			use_filter = CPU::FindFilter(argv[++i], filter_type);
+			if (!use_filter) std::cout << "Filtro desconocido, sin filtro." << std::endl;
+		}
+		else rom_path = argv[i];
+	}
+
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
 		std::cout << "Error iniciando SDL: " << SDL_GetError() << std::endl;
 		return -1;
@@ -18,8 +64,8 @@ int main(int argc, char* argv[]) {
 	SDL_Window* window = SDL_CreateWindow(
 		"C++ Boy",
 		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-		160 * SCALE, 144 * SCALE,
-		SDL_WINDOW_SHOWN
+		160 * scale, 144 * scale,
+		SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
 	);
 
 	if (!window) {
@@ -34,43 +80,110 @@ int main(int argc, char* argv[]) {
 		return -1;
 	}
 
-	SDL_AudioSpec wanted_spec;
-    SDL_zero(wanted_spec);
-    wanted_spec.freq = 44100;         // Calidad de CD
-    wanted_spec.format = AUDIO_F32SYS; // Flotantes de 32 bits (-1.0 a 1.0)
-    wanted_spec.channels = 1;         // Mono
-    wanted_spec.samples = 1024;       // Tamaño del buffer interno
-    wanted_spec.callback = nullptr;   // Uso QueueAudio, no necesito callback
+	// --filter: el escalado lo hace un FilterThread y la textura ya tiene el tamanio filtrado
+	std::unique_ptr<CPU::FilterThread> filter;
+	int texture_width = 160, texture_height = 144;
+	if (use_filter) {
+		filter = std::make_unique<CPU::FilterThread>(filter_type, scale, palette);
+		texture_width = filter->Width();
+		texture_height = filter->Height();
+	}
 
-    SDL_AudioDeviceID audio_device = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, nullptr, 0);
-    if (audio_device == 0) {
-        std::cout << "Error abriendo audio: " << SDL_GetError() << std::endl;
-    }
-    SDL_PauseAudioDevice(audio_device, 0); // Despausar (prender) el parlante
+	// El renderer escala la textura al tamanio de la ventana
+	SDL_RenderSetLogicalSize(renderer, texture_width, texture_height);
+	SDL_Texture* screen_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, texture_width, texture_height);
 
-    CPU::APU apu;
+	if (!screen_texture) {
+		std::cout << "Error creando textura: " << SDL_GetError() << std::endl;
+		return -1;
+	}
 
-	CPU::Processor cpu;
-	cpu.Init();
+	// Audio por callback: el APU llena un ring lock-free y SDL lo vacia en su hilo
+	CPU::AudioOutput audio;
+	if (!audio.Open(sample_rate, audio_latency_ms)) {
+		std::cout << "Error abriendo audio: " << SDL_GetError() << std::endl;
+	}
 
-	CPU::PPU ppu;
+	CPU::GameBoy gb;
+	if (audio.IsOpen()) gb.audio_output = &audio;
+	gb.Init();
+	gb.apu.SetSampleRate(sample_rate);
 
-	if (!cpu.LoadROM(argv[1])) {
+	if (!rom_path || !gb.LoadROM(rom_path)) {
 		std::cout << "ERROR: No se pudo cargar la ROM." << std::endl;
 
 		return -1;
 	}
 
-	std::cout << "ROM SIZE: " << cpu.GetRomSize() << std::endl;
+	std::cout << "ROM SIZE: " << gb.cpu.GetRomSize() << std::endl;
+
+	// --render-thread: las scanlines se dibujan en otro core
+	std::unique_ptr<CPU::RenderThread> renderer_worker;
+	if (render_thread) {
+		renderer_worker = std::make_unique<CPU::RenderThread>();
+		gb.SetRenderThread(renderer_worker.get());
+	}
 
 	bool quit = false;
-	bool debug_mode = false;
-	bool step_requested = false;
 	SDL_Event e;
 
+	// La emulacion corre en su hilo; este hilo presenta y marca el ritmo: cada vuelta
+	// habilita un frame mas cuando la cola de audio baja, y muestra el ultimo publicado.
+	CPU::EmuThread emulator(gb);
+	CPU::u8 joypad = 0;
+
+	// --capture: cada frame emulado y su audio van a un writer en otro hilo
+	CPU::CaptureWriter capture;
+	if (capture_path) {
+		if (capture.Open(capture_path, true, sample_rate)) emulator.SetCapture(&capture);
+		else std::cout << "No se pudo abrir la grabacion: " << capture_path << std::endl;
+	}
+	emulator.Start();
+	if (filter) filter->Start();
+	const bool filter_temporal = use_filter && CPU::GetFilterInfo(filter_type).temporal;
+
+	// F1: visores de tiles/mapas/OAM en otra ventana, alimentados con una copia de VRAM por frame
+	CPU::DebugViewers viewers;
+
+	// --stats: costo medio por frame de emulacion y de presentacion, una vez por segundo
+	const double counter_ms = 1000.0 / SDL_GetPerformanceFrequency();
+	Uint64 stats_start = SDL_GetPerformanceCounter();
+	Uint64 present_ticks = 0;
+	CPU::u64 stats_published = emulator.Frames().published;
+	CPU::u64 stats_filtered = 0;
+
+	// Si el frame no cambio no se convierte, sube ni presenta.
+	// Eventos de ventana (expose/resize) fuerzan un present.
+	CPU::u32 presented_serial = 0;
+	bool force_present = true;
+	const CPU::PipelineFrame* latest = nullptr;
+	const CPU::FilteredFrame* latest_filtered = nullptr;
+	CPU::u32 submitted_serial = 0;
+	bool submitted = false;
+	long long frames_presented = 0, frames_skipped = 0;
+	int stats_presented = 0, stats_skipped = 0;
+
+	// Deadlines de frame con el reloj del host; el audio se corrige con el ratio del APU
+	CPU::PacingController pacing;
+
+	// Edad del frame: desde que el emulador lo termino hasta que se presento
+	double age_total_ms = 0.0, age_max_ms = 0.0;
+
 	while (!quit) {
 		while (SDL_PollEvent(&e)) {
 			if (e.type == SDL_QUIT) quit = true;
+			if (e.type == SDL_WINDOWEVENT) {
+				force_present = true;
+				// Con dos ventanas SDL no manda SDL_QUIT al cerrar una
+				if (e.window.event == SDL_WINDOWEVENT_CLOSE) {
+					if (viewers.IsOpen() && e.window.windowID == viewers.WindowID()) {
+						viewers.Close();
+						emulator.EnableSnapshots(false);
+					} else {
+						quit = true;
+					}
+				}
+			}
 
             if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
                 bool pressed = (e.type == SDL_KEYDOWN);
@@ -88,60 +201,152 @@ int main(int argc, char* argv[]) {
                     case SDLK_RETURN: key = 7; break; // Start = Enter
                     
                     // Controles extra del emulador (solo se activan al apretar, no al mantener)
-                    case SDLK_SPACE: if(pressed) step_requested = true; break;
-                    case SDLK_p:     if(pressed) debug_mode = !debug_mode; break;
+                    case SDLK_SPACE: if(pressed) emulator.Step(); break;
+                    case SDLK_p:     if(pressed) emulator.ToggleDebug(); break;
+                    case SDLK_F1:
+                        if (!pressed) break;
+                        if (viewers.IsOpen()) viewers.Close();
+                        else if (!viewers.Open(palette)) std::cout << "Error abriendo los visores: " << SDL_GetError() << std::endl;
+                        emulator.EnableSnapshots(viewers.IsOpen());
+                        break;
                 }
 
                 if (key != -1) {
-                    cpu.UpdateJoypad(key, pressed);
+                    if (pressed) joypad |= (1 << key);
+                    else joypad &= ~(1 << key);
+                    emulator.SetJoypad(joypad);
                 }
             }
 		}
 
-		if (debug_mode) {
-			if (step_requested) {
-				int cycles = cpu.Step();
-				if (cycles > 0) {
-					ppu.Tick(cycles * 4, cpu.bus);
-				}
-				step_requested = false;
-			}
+		// Ritmo: un frame por deadline (59.73 Hz). Con el ring por debajo de la mitad del
+		// objetivo (arranque, underrun) se pide sin esperar hasta recuperarlo.
+		if (emulator.InDebug()) {
+			SDL_Delay(5);
+			pacing.Resync();
 		} else {
-			int cycles_this_frame = 0;
-
-			while (cycles_this_frame < CYCLES_PER_FRAME) {
-				cpu.HandleInterrupts();
-				int cycles = cpu.Step();
-				if (cycles == 0) { 
-                    debug_mode = true; 
-					std::cout << ">>> BREAKPOINT ALCANZADO: Salimos del bucle! <<<" << std::endl;
-                    break; 
-                }
-				cycles_this_frame += cycles;
+			if (audio.IsOpen() && audio.Fill() < audio.TargetSamples() / 2) pacing.Resync();
+			else pacing.WaitNextFrame();
+			if (audio.IsOpen()) emulator.SetAudioRatio(pacing.UpdateRatio(audio.Fill(), audio.TargetSamples()));
+			emulator.RequestFrame();
+		}
+
+		const CPU::PipelineFrame* fresh = emulator.Frames().TakeLatest();
+		if (fresh) latest = fresh;
 
-				ppu.Tick(cycles * 4, cpu.bus);
-				apu.Tick(cycles * 4, cpu.bus, audio_device);
+		// Con filtro: los frames nuevos van al FilterThread (los temporales siempre, porque
+		// el fantasma sigue cambiando) y se presenta lo ultimo que salio filtrado
+		bool fresh_output = fresh != nullptr;
+		CPU::u32 output_serial = latest ? latest->serial : 0;
+		std::chrono::steady_clock::time_point emulated_at = latest ? latest->emulated_at : std::chrono::steady_clock::time_point();
+		if (filter) {
+			if (fresh && (filter_temporal || !submitted || fresh->serial != submitted_serial)) {
+				filter->Submit(*fresh);
+				submitted_serial = fresh->serial;
+				submitted = true;
 			}
+			const CPU::FilteredFrame* filtered = filter->TakeLatest();
+			if (filtered) latest_filtered = filtered;
+			fresh_output = filtered != nullptr;
+			output_serial = latest_filtered ? latest_filtered->serial : 0;
+			if (latest_filtered) emulated_at = latest_filtered->emulated_at;
 		}
+		bool have_output = filter ? latest_filtered != nullptr : latest != nullptr;
+		bool changed = filter ? fresh_output : output_serial != presented_serial;
 
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); 
-        SDL_RenderClear(renderer);
-		ppu.DrawFrame(renderer);
-		SDL_RenderPresent(renderer);
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		if (have_output && (force_present || changed)) {
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); 
+			SDL_RenderClear(renderer);
+			if (filter) CPU::DrawFilteredFrame(renderer, screen_texture, *latest_filtered, texture_width, texture_height);
+			else CPU::DrawIndexedFrame(renderer, screen_texture, latest->pixels, palette);
+			SDL_RenderPresent(renderer);
 
-		//SDL_Delay(8);
-		while (SDL_GetQueuedAudioSize(audio_device) > 4096) {
-			SDL_Delay(1);
+			double age_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - emulated_at).count();
+			age_total_ms += age_ms;
+			age_max_ms = std::max(age_max_ms, age_ms);
+
+			presented_serial = output_serial;
+			force_present = false;
+			frames_presented++;
+			stats_presented++;
+		} else if (fresh) {
+			frames_skipped++;
+			stats_skipped++;
 		}
+		present_ticks += SDL_GetPerformanceCounter() - t0;
+
+		if (viewers.IsOpen()) {
+			const CPU::VideoSnapshot* snapshot = emulator.TakeSnapshot();
+			if (snapshot) {
+				viewers.Update(*snapshot);
+				viewers.Present();
+			}
+		}
+
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (show_stats && (now - stats_start) * counter_ms >= 1000.0) {
+			CPU::u64 published = emulator.Frames().published;
+			int emulated = (int)(published - stats_published);
+			std::cout << "[STATS] " << emulated << " fps | Emulacion: " << (emulated ? emulator.TakeEmulateNanoseconds() / 1e6 / emulated : 0.0)
+			          << " ms/frame | Presentacion: " << (stats_presented ? present_ticks * counter_ms / stats_presented : 0.0) << " ms/frame"
+			          << " | Presentados: " << stats_presented << " salteados: " << stats_skipped
+			          << " | Edad del frame: " << (stats_presented ? age_total_ms / stats_presented : 0.0) << " ms media, "
+			          << age_max_ms << " ms max | Descartados: " << emulator.Frames().dropped
+			          << " | Deadlines tarde: " << pacing.late_frames;
+			if (filter) {
+				CPU::u64 filtered = filter->Filtered();
+				int count = (int)(filtered - stats_filtered);
+				std::cout << " | Filtro " << CPU::GetFilterInfo(filter_type).name << ": "
+				          << (count ? filter->TakeFilterNanoseconds() / 1e6 / count : 0.0) << " ms/frame";
+				stats_filtered = filtered;
+			}
+			if (audio.IsOpen()) {
+				std::cout << " | Audio: " << audio.FillMilliseconds() << " ms en el ring, ratio " << pacing.Ratio() << ", "
+				          << audio.Underruns() << " underruns, " << audio.Overruns() << " overruns";
+			}
+			if (viewers.IsOpen()) {
+				std::cout << " | Visores: " << (viewers.updates ? viewers.update_ns / 1e6 / viewers.updates : 0.0)
+				          << " ms/refresh, " << viewers.tiles_decoded << " tiles decodificados";
+				viewers.update_ns = 0;
+				viewers.updates = 0;
+				viewers.tiles_decoded = 0;
+			}
+			std::cout << std::endl;
+			stats_start = now;
+			stats_published = published;
+			present_ticks = 0;
+			stats_presented = stats_skipped = 0;
+			age_total_ms = age_max_ms = 0.0;
+		}
+	}
+
+	emulator.Stop();
+	if (audio.IsOpen()) {
+		std::cout << ">>> Audio: " << audio.Underruns() << " underruns (" << audio.UnderrunSamples() << " muestras), "
+		          << audio.Overruns() << " overruns (" << audio.OverrunSamples() << " muestras)" << std::endl;
+	}
+	if (capture.IsOpen()) {
+		CPU::CaptureStats stats = capture.Close();
+		std::cout << ">>> Grabacion: " << stats.frames << " frames (" << stats.stored << " completos, "
+		          << stats.repeats << " repetidos, " << stats.dropped << " descartados), "
+		          << stats.audio_samples << " muestras, " << stats.bytes / 1024 << " KB";
+		if (stats.write_seconds > 0) std::cout << ", writer a " << (int)(stats.frames / stats.write_seconds) << " frames/s";
+		std::cout << std::endl;
 	}
+	if (filter) filter->Stop();
 
-	std::cout << ">>> Apagando consola..." << std::endl;
+	std::cout << ">>> Apagando consola... (frames presentados: " << frames_presented
+	          << ", salteados sin cambios: " << frames_skipped << ")" << std::endl;
 
-	cpu.SaveGame();
+	gb.cpu.SaveGame();
+	gb.SetRenderThread(nullptr);
 
+	viewers.Close();
+	SDL_DestroyTexture(screen_texture);
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
-	SDL_CloseAudioDevice(audio_device);
+	audio.Close();
 	SDL_Quit();
 
 	return 0;
@@ -1,4 +1,9 @@
 #include "PPU.hpp"
+#include "RenderThread.hpp"
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 using namespace CPU;
 
@@ -7,6 +12,27 @@ PPU::PPU() {
     current_mode = OAM_SCAN;
     line_y = 0;
     std::fill(std::begin(screen_buffer), std::end(screen_buffer), 0);
+    std::fill(std::begin(frame_buffer), std::end(frame_buffer), 0);
+}
+
+void PPU::SaveState(StateWriter& state) const {
+    state.Put(mode_clock);
+    state.Put(current_mode);
+    state.Put(line_y);
+    state.Bytes(screen_buffer, sizeof(screen_buffer));
+    state.Bytes(frame_buffer, sizeof(frame_buffer));
+    state.Bytes(changed_lines, sizeof(changed_lines));
+    state.Put(frame_serial);
+}
+
+void PPU::LoadState(StateReader& state) {
+    state.Get(mode_clock);
+    state.Get(current_mode);
+    state.Get(line_y);
+    state.Bytes(screen_buffer, sizeof(screen_buffer));
+    state.Bytes(frame_buffer, sizeof(frame_buffer));
+    state.Bytes(changed_lines, sizeof(changed_lines));
+    state.Get(frame_serial);
 }
 
 void PPU::UpdateLY(Memory_Bus& bus, u8 value) {
@@ -18,16 +44,14 @@ void PPU::UpdateLY(Memory_Bus& bus, u8 value) {
 void PPU::SetMode(PPUMode mode, Memory_Bus& bus) {
     current_mode = mode;
 
-    u8 stat = bus.Read(0xFF41);
+    u8 stat = bus.GetLCD().STAT;
     stat &= 0xFC;
     stat |= (mode & 0x03);
     bus.UpdateSTAT(stat);
 }
 
 void PPU::Tick(u8 cycles, Memory_Bus& bus) {
-    u8 lcdc = bus.Read(0xFF40);
-    
-    if (!(lcdc & 0x80)) { 
+    if (!(bus.GetLCD().LCDC & 0x80)) { 
         mode_clock = 0;
         line_y = 0;
         bus.UpdateLY(0);
@@ -47,7 +71,8 @@ void PPU::Tick(u8 cycles, Memory_Bus& bus) {
         case DRAWING:
             if (mode_clock >= 172) {
                 mode_clock -= 172;
-                RenderScanline(bus); 
+                if (render_thread) render_thread->SubmitLine(bus, line_y);
+                else RenderScanline(bus, line_y); 
                 SetMode(HBLANK, bus);
             }
             break;
@@ -58,8 +83,11 @@ void PPU::Tick(u8 cycles, Memory_Bus& bus) {
                 UpdateLY(bus, line_y + 1);
 
                 if (line_y == 144) {
+                    if (render_thread) render_thread->SubmitFrame();
+                    else CompleteFrame();
                     SetMode(VBLANK, bus);
                     bus.RequestInterrupt(0);
+                    vblanks++;
                 } else {
                     SetMode(OAM_SCAN, bus);
                 }
@@ -80,152 +108,138 @@ void PPU::Tick(u8 cycles, Memory_Bus& bus) {
     }
 }
 
-void PPU::DrawPixel(SDL_Renderer* renderer, int x, int y, int color_id) {
-    int r, g, b;
-    const int SCALE = 3;
-    switch (color_id) {
-        case 0: r=255; g=255; b=255; break; // Blanco
-        case 1: r=170; g=170; b=170; break; // Gris Claro
-        case 2: r=85;  g=85;  b=85;  break; // Gris Oscuro
-        case 3: r=0;   g=0;   b=0;   break; // Negro
+// Indices de color (0-3) -> tonos segun BGP/OBP, 16 pixeles por pshufb
+static void ApplyPalette(u8* pixels, int count, u8 palette) {
+    u8 shades[16] = {};
+    for (int i = 0; i < 4; i++) shades[i] = (palette >> (i * 2)) & 0x03;
+
+    int x = 0;
+#if defined(__SSSE3__)
+    __m128i table = _mm_loadu_si128((const __m128i*)shades);
+    for (; x + 16 <= count; x += 16) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(pixels + x));
+        _mm_storeu_si128((__m128i*)(pixels + x), _mm_shuffle_epi8(table, idx));
     }
-    SDL_SetRenderDrawColor(renderer, r, g, b, 255);
-    SDL_Rect rect = {x * SCALE, y * SCALE, SCALE, SCALE}; 
-    SDL_RenderFillRect(renderer, &rect);
+#endif
+    for (; x < count; x++) pixels[x] = shades[pixels[x]];
 }
 
-void PPU::DebugDrawTiles(SDL_Renderer* renderer, CPU::Memory_Bus& bus) {
-    int x_draw = 0;
-    int y_draw = 0;
-    int tile_count = 0;
-
-    for (int addr = 0x8000; addr < 0x9800; addr += 16) {
-        
-        for (int row = 0; row < 8; row++) {
-            u8 byte1 = bus.Read(addr + (row * 2));
-            u8 byte2 = bus.Read(addr + (row * 2) + 1);
-
-            for (int bit = 7; bit >= 0; bit--) {
-                int hi = (byte2 >> bit) & 1;
-                int lo = (byte1 >> bit) & 1;
-                int color = (hi << 1) | lo;
-
-                this->DrawPixel(renderer, x_draw + (7 - bit), y_draw + row, color);
-            }
-        }
-
-        x_draw += 8;
-        if (x_draw >= 160) { 
-            x_draw = 0;
-            y_draw += 8;
-        }
-    }
-}
-
-void PPU::RenderScanline(Memory_Bus& bus) {
-    u8 lcdc = bus.Read(0xFF40);
+void PPU::RenderScanline(Memory_Bus& bus, u8 line) {
+    const LcdRegisters& lcd = bus.GetLCD();
+    const u8* vram = bus.GetVRAM();
+    u8 lcdc = lcd.LCDC;
 
     if (!(lcdc & 0x01)) return; 
 
-    u8 scy = bus.Read(0xFF42);
-    u8 scx = bus.Read(0xFF43);
-    u8 bgp = bus.Read(0xFF47);
+    u8 scy = lcd.SCY;
+    u8 scx = lcd.SCX;
+    u8 bgp = lcd.BGP;
 
-    u8 y_pos = scy + line_y;
+    u8 y_pos = scy + line;
 
     u16 tile_row = (y_pos / 8) * 32;
 
-    u16 map_base = (lcdc & 0x08) ? 0x9C00 : 0x9800;
+    const u8* map = vram + ((lcdc & 0x08) ? 0x1C00 : 0x1800) + tile_row;
 
     bool unsigned_tiles = (lcdc & 0x10) != 0;
-    u16 tile_data_base = unsigned_tiles ? 0x8000 : 0x8800;
-
-    for (int x = 0; x < 160; x++) {
-        u8 x_pos = x + scx;
-
-        u16 tile_col = x_pos / 8;
+    u8 line_in_tile = y_pos % 8;
 
-        u16 tile_address = map_base + tile_row + tile_col;
-        u8 tile_num = bus.Read(tile_address);
+    // Fondo por filas de tile: 21 tiles cubren los 160 pixeles mas el scroll fino
+    // de SCX, que solo se aplica al copiar desde row_pixels.
+    u8 row_pixels[21 * 8];
+    u8 first_col = scx / 8;
 
-        u16 tile_location = tile_data_base;
-        if (unsigned_tiles) {
-            tile_location += (tile_num * 16);
-        } else {
-            s8 signed_num = (s8)tile_num;
-            tile_location = 0x9000 + (signed_num * 16);
-        }
-
-        u8 line_in_tile = y_pos % 8;
-        u8 byte1 = bus.Read(tile_location + (line_in_tile * 2));
-        u8 byte2 = bus.Read(tile_location + (line_in_tile * 2) + 1);
-
-        int bit_index = 7 - (x_pos % 8);
+    for (int tile = 0; tile < 21; tile++) {
+        u16 tile_col = (first_col + tile) & 31;
+        u8 tile_num = map[tile_col];
 
-        int lo = (byte1 >> bit_index) & 1;
-        int hi = (byte2 >> bit_index) & 1;
-        int color_id = (hi << 1) | lo;
+        // Indice en la cache: 0x8000 + n*16 o 0x9000 + (s8)n*16
+        int cache_index = unsigned_tiles ? tile_num : 256 + (s8)tile_num;
+        std::memcpy(row_pixels + tile * 8, bus.TileRow(cache_index, line_in_tile, false), 8);
+    }
 
-        int real_color = (bgp >> (color_id * 2)) & 0x03;
+    ApplyPalette(row_pixels, sizeof(row_pixels), bgp);
 
-        screen_buffer[line_y * 160 + x] = real_color;
-    }
+    u8* out = &screen_buffer[line * 160];
+    std::memcpy(out, row_pixels + (scx % 8), 160);
 
     if (lcdc & 0x02) {
         bool use_8x16 = (lcdc & 0x04) != 0;
         u8 sprite_height = use_8x16 ? 16 : 8;
 
-        u8 obp0 = bus.Read(0xFF48); 
-        u8 obp1 = bus.Read(0xFF49); 
-
-        for (int sprite = 0; sprite < 40; sprite++) {
-            u16 index = sprite * 4;
-            u8 y_pos = bus.Read(0xFE00 + index) - 16;
-            u8 x_pos = bus.Read(0xFE00 + index + 1) - 8;
-            u8 tile_index = bus.Read(0xFE00 + index + 2);
-            u8 attributes = bus.Read(0xFE00 + index + 3);
-
-            if (line_y >= y_pos && line_y < (y_pos + sprite_height)) {
-                
-                bool y_flip = (attributes & 0x40) != 0;
-                bool x_flip = (attributes & 0x20) != 0;
-                u8 palette = (attributes & 0x10) ? obp1 : obp0;
+        u8 obp0 = lcd.OBP0; 
+        u8 obp1 = lcd.OBP1; 
+        const u8* oam = bus.GetOAM();
+
+        // Como el hardware: los primeros 10 sprites de la linea en orden de OAM,
+        // y entre ellos gana el de menor X (a igual X, el de menor indice)
+        u8 selected[10];
+        int count = 0;
+        for (u64 mask = bus.SpritesOnLine(line, use_8x16); mask && count < 10; mask &= mask - 1) {
+            u8 sprite = __builtin_ctzll(mask);
+            int pos = count++;
+            while (pos > 0 && oam[selected[pos - 1] * 4 + 1] > oam[sprite * 4 + 1]) {
+                selected[pos] = selected[pos - 1];
+                pos--;
+            }
+            selected[pos] = sprite;
+        }
 
-                int line = line_y - y_pos;
-                if (y_flip) line = sprite_height - 1 - line;
+        // Del de menor prioridad al de mayor, asi el ultimo en pintar queda arriba
+        for (int k = count - 1; k >= 0; k--) {
+            const u8* entry = oam + selected[k] * 4;
+            int y_pos = entry[0] - 16;
+            int x_pos = entry[1] - 8;
+            u8 tile_index = entry[2];
+            u8 attributes = entry[3];
 
-                if (use_8x16) tile_index &= 0xFE;
+            bool y_flip = (attributes & 0x40) != 0;
+            bool x_flip = (attributes & 0x20) != 0;
+            u8 palette = (attributes & 0x10) ? obp1 : obp0;
 
-                u16 data_address = 0x8000 + (tile_index * 16) + (line * 2);
-                u8 byte1 = bus.Read(data_address);
-                u8 byte2 = bus.Read(data_address + 1);
+            int sprite_line = line - y_pos;
+            if (y_flip) sprite_line = sprite_height - 1 - sprite_line;
 
-                for (int tile_pixel = 7; tile_pixel >= 0; tile_pixel--) {
-                    int color_bit = x_flip ? (7 - tile_pixel) : tile_pixel;
+            if (use_8x16) tile_index &= 0xFE;
 
-                    int lo = (byte1 >> color_bit) & 1;
-                    int hi = (byte2 >> color_bit) & 1;
-                    int color_id = (hi << 1) | lo;
+            // En 8x16 la mitad de abajo es el tile siguiente
+            const u8* row = bus.TileRow(tile_index + sprite_line / 8, sprite_line % 8, x_flip);
 
-                    if (color_id == 0) continue;
+            for (int px = 0; px < 8; px++) {
+                int color_id = row[px];
+                if (color_id == 0) continue;
 
-                    int pixel_x = x_pos + (7 - tile_pixel);
-                    
-                    if (pixel_x < 0 || pixel_x >= 160) continue;
+                int pixel_x = x_pos + px;
+                if (pixel_x < 0 || pixel_x >= 160) continue;
 
-                    int real_color = (palette >> (color_id * 2)) & 0x03;
-                    
-                    screen_buffer[line_y * 160 + pixel_x] = real_color;
-                }
+                out[pixel_x] = (palette >> (color_id * 2)) & 0x03;
             }
         }
     }
+
+    if (std::memcmp(out, &frame_buffer[line * 160], 160) != 0) {
+        changed_lines[line >> 6] |= 1ull << (line & 63);
+    }
 }
-void PPU::DrawFrame(SDL_Renderer* renderer) {
-    for (int y = 0; y < 144; y++) {
-        for (int x = 0; x < 160; x++) {
-            int color = screen_buffer[y * 160 + x];
-            DrawPixel(renderer, x, y, color);
+void PPU::CompleteFrame() {
+    if (!(changed_lines[0] | changed_lines[1] | changed_lines[2])) return;
+
+    for (int word = 0; word < 3; word++) {
+        for (u64 mask = changed_lines[word]; mask; mask &= mask - 1) {
+            int line = word * 64 + __builtin_ctzll(mask);
+            std::memcpy(&frame_buffer[line * 160], &screen_buffer[line * 160], 160);
         }
+        changed_lines[word] = 0;
     }
+    frame_serial++;
+}
+
+u32 PPU::FrameSerial() const {
+    return render_thread ? render_thread->FrameSerial() : frame_serial;
+}
+
+u32 PPU::CopyFrame(u8* dst) const {
+    if (render_thread) return render_thread->CopyFrame(dst);
+    std::memcpy(dst, frame_buffer, sizeof(frame_buffer));
+    return frame_serial;
 }
\ No newline at end of file
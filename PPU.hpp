@@ -1,9 +1,10 @@
 #pragma once
 #include "CPU.hpp"
+#include "Video.hpp"
 #include <SDL2/SDL.h>
 
 namespace CPU {
-    using u32 = uint32_t; 
+    class RenderThread;
 
     enum PPUMode {
         OAM_SCAN    = 2,
@@ -18,19 +19,42 @@ namespace CPU {
         PPUMode current_mode;
         u8 line_y;
 
-        u32 screen_buffer[160 * 144];
+        // Un tono (0-3) por byte. Se dibuja en screen_buffer y al entrar en VBlank
+        // se copia a frame_buffer, que queda quieto hasta el proximo frame.
+        u8 screen_buffer[160 * 144];
+        u8 frame_buffer[160 * 144];
+        // Lineas de screen_buffer distintas de frame_buffer; en VBlank solo se copian esas
+        u64 changed_lines[3] = {};
+        u32 frame_serial = 0;
+        u32 vblanks = 0;        // Entradas a VBlank (para alinear RunFrame); no va al save state
+
+        // Si esta puesto, las lineas se mandan al render thread en vez de dibujarse aca
+        RenderThread* render_thread = nullptr;
 
         public:
         PPU();
 
         void Tick(u8 cycles, Memory_Bus& bus);
-        void DebugDrawTiles(SDL_Renderer* renderer, Memory_Bus& bus);
-        void DrawFrame(SDL_Renderer* renderer);
-        void RenderScanline(Memory_Bus& bus);
+        void RenderScanline(Memory_Bus& bus, u8 line);
+        // Ultimo frame completo (indices), para ExpandFrame / hashing / la API embebible
+        const u8* GetFrame() const { return frame_buffer; }
+        // Copia el ultimo frame completo (con render thread, el que publico el worker)
+        // y devuelve su serial
+        u32 CopyFrame(u8* dst) const;
+        // Sube solo cuando un frame completo difiere del anterior: si no cambio,
+        // el frontend puede saltear conversion, upload y present
+        u32 FrameSerial() const;
+        void CompleteFrame();   // Fin de frame (VBlank): publica las lineas que cambiaron
+        u32 VBlankCount() const { return vblanks; }
+
+        // No es duenia del worker; lo conecta GameBoy::SetRenderThread
+        void SetRenderThread(RenderThread* worker) { render_thread = worker; }
+        RenderThread* GetRenderThread() const { return render_thread; }
+        void SaveState(StateWriter& state) const;
+        void LoadState(StateReader& state);
 
         private:
         void SetMode(PPUMode mode, Memory_Bus& bus);
         void UpdateLY(Memory_Bus& bus, u8 value);
-        void DrawPixel(SDL_Renderer* renderer, int x, int y, int color_id);
     };
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "Pacing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace CPU;
+
+PacingController::PacingController() {
+    frequency = SDL_GetPerformanceFrequency();
+    period = frequency * 70224 / 4194304;
+    next_deadline = SDL_GetPerformanceCounter() + period;
+}
+
+void PacingController::WaitNextFrame() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now >= next_deadline) {
+        late_frames++;
+        if (now - next_deadline > 3 * period) next_deadline = now;
+    } else {
+        // Durmiendo con timer de alta resolucion (sleep_for, clock_nanosleep en Linux) hasta
+        // SPIN_MICROSECONDS antes; solo ese ultimo tramo se espera activo
+        Uint64 margin = frequency * SPIN_MICROSECONDS / 1000000;
+        if (next_deadline - now > margin) {
+            Uint64 ticks = next_deadline - now - margin;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ticks * 1000000000 / frequency));
+        }
+        while (SDL_GetPerformanceCounter() < next_deadline) std::this_thread::yield();
+    }
+    next_deadline += period;
+}
+
+// PI sobre el error del llenado promediado (el promedio evita reaccionar al diente de
+// sierra de cada frame). La parte proporcional corrige rapido; la integral absorbe la
+// diferencia fija entre los dos relojes para que el ring quede en el objetivo.
+double PacingController::UpdateRatio(size_t fill, size_t target) {
+    if (target == 0) return ratio;
+    smoothed_fill = smoothed_fill < 0.0 ? fill : smoothed_fill * 0.95 + fill * 0.05;
+    double error = std::max(-1.0, std::min((target - smoothed_fill) / target, 1.0));
+    integral = std::max(-MAX_ADJUST, std::min(integral + error * MAX_ADJUST * 0.002, MAX_ADJUST));
+    ratio = 1.0 + std::max(-MAX_ADJUST, std::min(error * MAX_ADJUST + integral, MAX_ADJUST));
+    return ratio;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "CPU.hpp"
+#include <SDL2/SDL.h>
+
+namespace CPU {
+    // Ritmo del presentador. Los frames salen con deadlines fijos de 70224 clocks (59.73 Hz)
+    // medidos con el reloj del host: se duerme con un timer de alta resolucion hasta 50 us
+    // antes y solo eso se espera activo, asi el core queda libre entre frames. Como el
+    // reloj del host y el de la placa de audio nunca coinciden, el ring de audio se
+    // mantiene en su objetivo ajustando cuantas muestras genera el APU por frame (ratio de
+    // resampleo, +-0.5%) segun cuanto tiene.
+    class PacingController {
+        public:
+        static constexpr double MAX_ADJUST = 0.005;
+        // Lo que se espera activo antes de cada deadline (el sleep puede despertar tarde)
+        static constexpr Uint64 SPIN_MICROSECONDS = 50;
+
+        private:
+        Uint64 frequency;
+        Uint64 period;              // Ticks del contador por frame
+        Uint64 next_deadline;
+        double smoothed_fill = -1.0;
+        double integral = 0.0;
+        double ratio = 1.0;
+
+        public:
+        PacingController();
+
+        // Duerme hasta el deadline del proximo frame. Si quedo mas de 3 frames atras
+        // (pausa, ventana arrastrada) no intenta alcanzarlos: arranca de nuevo desde ahora.
+        void WaitNextFrame();
+        // Proximo frame ya, sin esperar (el audio se esta por quedar sin muestras)
+        void Resync() { next_deadline = SDL_GetPerformanceCounter() + period; }
+
+        // Con el llenado del ring despues de pedir un frame: devuelve el ratio para el APU
+        double UpdateRatio(size_t fill, size_t target);
+        double Ratio() const { return ratio; }
+        u64 late_frames = 0;        // Deadlines que ya habian pasado al llegar
+    };
+}
@@ -0,0 +1,220 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
+#include <sstream>
+
+using namespace CPU;
+
+static const char* INTERRUPT_NAMES[5] = {"VBlank", "STAT", "Timer", "Serial", "Joypad"};
+static constexpr u32 ROOT_FUNCTION = 0xFFFFFFFF;
+
+Profiler::Profiler() {
+    Reset();
+}
+
+void Profiler::Reset() {
+    low.reset(new Counter[0x4000]());
+    high.reset(new Counter[0x8000]());
+    banks.clear();
+    banks.resize(256);
+    std::fill(std::begin(opcodes), std::end(opcodes), Counter());
+    std::fill(std::begin(cb_opcodes), std::end(cb_opcodes), Counter());
+    std::fill(std::begin(interrupts), std::end(interrupts), 0);
+    halt_cycles = 0;
+    overflows = 0;
+    nodes.assign(1, Node{0, ROOT_FUNCTION});
+    children.clear();
+    stack.clear();
+    current = 0;
+}
+
+Profiler::Counter& Profiler::At(u8 rom_bank, u16 pc) {
+    if (pc < 0x4000) return low[pc];
+    if (pc >= 0x8000) return high[pc - 0x8000];
+    std::unique_ptr<Counter[]>& bank = banks[rom_bank];
+    if (!bank) bank.reset(new Counter[0x4000]());
+    return bank[pc - 0x4000];
+}
+
+void Profiler::Enter(u32 function, u16 sp) {
+    // Codigo que apila direcciones y salta sin volver nunca: se empieza de nuevo
+    if (stack.size() >= MAX_DEPTH) {
+        overflows++;
+        stack.clear();
+        current = 0;
+    }
+    u64 edge = ((u64)current << 32) | function;
+    auto it = children.find(edge);
+    u32 node;
+    if (it != children.end()) {
+        node = it->second;
+    } else {
+        node = (u32)nodes.size();
+        nodes.push_back(Node{current, function});
+        children.emplace(edge, node);
+    }
+    nodes[node].calls++;
+    stack.push_back(Frame{node, sp});
+    current = node;
+}
+
+// Cierra todos los frames cuyo SP de entrada ya quedo restaurado (RET normal, o una
+// pila que se reinicio con LD SP)
+void Profiler::Leave(u16 sp) {
+    while (!stack.empty() && stack.back().sp <= sp) stack.pop_back();
+    current = stack.empty() ? 0 : stack.back().node;
+}
+
+bool Profiler::LoadSymbols(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find(';');
+        if (comment != std::string::npos) line.erase(comment);
+        unsigned bank, address;
+        char name[256];
+        if (std::sscanf(line.c_str(), "%x:%x %255s", &bank, &address, name) == 3 && bank < 256 && address < 0x10000) {
+            symbols[Key((u8)bank, (u16)address)] = name;
+        }
+    }
+    return true;
+}
+
+std::string Profiler::Name(u32 key) const {
+    if (key == ROOT_FUNCTION) return "(raiz)";
+    auto it = symbols.upper_bound(key);
+    if (it != symbols.begin() && std::prev(it)->first == key) return std::prev(it)->second;
+    // Un vector sin simbolo propio no es parte del RST de arriba
+    if ((key >> 16) == 0 && (key & 0xFFFF) >= 0x40 && (key & 0xFFFF) <= 0x60 && (key & 7) == 0) {
+        return std::string("int_") + INTERRUPT_NAMES[((key & 0xFFFF) - 0x40) / 8];
+    }
+    if (it != symbols.begin()) {
+        --it;
+        if ((it->first >> 16) == (key >> 16) && key - it->first < 0x4000) {
+            std::ostringstream name;
+            name << it->second << "+0x" << std::hex << (key - it->first);
+            return name.str();
+        }
+    }
+    std::ostringstream name;
+    name << std::hex << std::uppercase << std::setfill('0') << std::setw(2) << (key >> 16) << ":" << std::setw(4) << (key & 0xFFFF);
+    return name.str();
+}
+
+static double Percent(u64 part, u64 total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+void Profiler::WriteFlat(std::ostream& out, size_t top) const {
+    // Todos los contadores planos como (clave, contador)
+    std::vector<std::pair<u32, Counter>> locations;
+    u64 instructions = 0, cycles = 0;
+    auto collect = [&](const Counter* counters, size_t count, u8 bank, u16 base) {
+        for (size_t i = 0; i < count; i++) {
+            if (counters[i].instructions == 0) continue;
+            locations.emplace_back(Key(bank, (u16)(base + i)), counters[i]);
+            instructions += counters[i].instructions;
+            cycles += counters[i].cycles;
+        }
+    };
+    collect(low.get(), 0x4000, 0, 0x0000);
+    for (int bank = 0; bank < 256; bank++) {
+        if (banks[bank]) collect(banks[bank].get(), 0x4000, (u8)bank, 0x4000);
+    }
+    collect(high.get(), 0x8000, 0, 0x8000);
+
+    out << std::fixed << std::setprecision(2);
+    out << "Instrucciones: " << instructions << " | Ciclos: " << cycles << " | Ciclos en HALT: " << halt_cycles << std::endl;
+    out << "Interrupciones:";
+    for (int i = 0; i < 5; i++) out << " " << INTERRUPT_NAMES[i] << "=" << interrupts[i];
+    out << " | Desbordes de pila: " << overflows << std::endl;
+
+    // Por funcion: propios sumando todos sus nodos; inclusivos sin contar dos veces una
+    // recursion (solo el nodo mas alto de cada cadena con la misma funcion)
+    std::vector<u64> subtree(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;) {
+        subtree[i] += nodes[i].cycles;
+        if (i > 0) subtree[nodes[i].parent] += subtree[i];
+    }
+    struct FunctionStats { u64 self = 0, total = 0, calls = 0; };
+    std::map<u32, FunctionStats> functions;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        FunctionStats& f = functions[nodes[i].function];
+        f.self += nodes[i].cycles;
+        f.calls += nodes[i].calls;
+        bool nested = false;
+        for (u32 p = nodes[i].parent; i > 0 && !nested; p = nodes[p].parent) {
+            nested = nodes[p].function == nodes[i].function;
+            if (p == 0) break;
+        }
+        if (!nested) f.total += subtree[i];
+    }
+    std::vector<std::pair<u32, FunctionStats>> by_function(functions.begin(), functions.end());
+    std::sort(by_function.begin(), by_function.end(), [](const auto& a, const auto& b) { return a.second.self > b.second.self; });
+    out << std::endl << "== Por funcion (ciclos propios / inclusivos) ==" << std::endl;
+    for (size_t i = 0; i < by_function.size() && i < top; i++) {
+        const FunctionStats& f = by_function[i].second;
+        out << std::setw(7) << Percent(f.self, cycles) << "% " << std::setw(7) << Percent(f.total, cycles) << "% "
+            << std::setw(12) << f.self << " " << std::setw(12) << f.total << " " << std::setw(9) << f.calls
+            << "  " << Name(by_function[i].first) << std::endl;
+    }
+
+    out << std::endl << "== Por banco ==" << std::endl;
+    std::map<int, Counter> per_bank;
+    for (const auto& l : locations) {
+        u16 pc = l.first & 0xFFFF;
+        int bank = pc < 0x4000 ? -1 : pc >= 0x8000 ? -2 : (int)(l.first >> 16);
+        per_bank[bank].instructions += l.second.instructions;
+        per_bank[bank].cycles += l.second.cycles;
+    }
+    for (const auto& b : per_bank) {
+        std::string label = b.first == -1 ? "ROM0" : b.first == -2 ? "RAM" : "ROM" + std::to_string(b.first);
+        out << std::setw(7) << Percent(b.second.cycles, cycles) << "% " << std::setw(12) << b.second.cycles
+            << " " << std::setw(12) << b.second.instructions << "  " << label << std::endl;
+    }
+
+    std::sort(locations.begin(), locations.end(), [](const auto& a, const auto& b) { return a.second.cycles > b.second.cycles; });
+    out << std::endl << "== Por PC (ciclos, instrucciones) ==" << std::endl;
+    for (size_t i = 0; i < locations.size() && i < top; i++) {
+        const Counter& c = locations[i].second;
+        out << std::setw(7) << Percent(c.cycles, cycles) << "% " << std::setw(12) << c.cycles << " " << std::setw(12)
+            << c.instructions << "  " << std::hex << std::uppercase << std::setfill('0') << std::setw(2) << (locations[i].first >> 16)
+            << ":" << std::setw(4) << (locations[i].first & 0xFFFF) << std::dec << std::setfill(' ') << " " << Name(locations[i].first) << std::endl;
+    }
+
+    std::vector<std::pair<int, Counter>> ops;
+    for (int i = 0; i < 256; i++) {
+        if (opcodes[i].instructions) ops.emplace_back(i, opcodes[i]);
+        if (cb_opcodes[i].instructions) ops.emplace_back(0xCB00 | i, cb_opcodes[i]);
+    }
+    std::sort(ops.begin(), ops.end(), [](const auto& a, const auto& b) { return a.second.cycles > b.second.cycles; });
+    out << std::endl << "== Por opcode (ciclos, instrucciones) ==" << std::endl;
+    for (const auto& op : ops) {
+        out << std::setw(7) << Percent(op.second.cycles, cycles) << "% " << std::setw(12) << op.second.cycles << " "
+            << std::setw(12) << op.second.instructions << "  " << std::hex << std::uppercase << std::setfill('0')
+            << (op.first > 0xFF ? "CB " : "") << std::setw(2) << (op.first & 0xFF) << std::dec << std::setfill(' ') << std::endl;
+    }
+}
+
+void Profiler::WriteFolded(std::ostream& out) const {
+    std::vector<std::string> paths(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        // Los padres siempre se crean antes que los hijos
+        paths[i] = i == 0 ? Name(ROOT_FUNCTION) : (nodes[i].parent == 0 ? "" : paths[nodes[i].parent] + ";") + Name(nodes[i].function);
+        if (nodes[i].cycles) out << paths[i] << " " << nodes[i].cycles << "\n";
+        if (nodes[i].halt_cycles) out << paths[i] << ";(halt) " << nodes[i].halt_cycles << "\n";
+    }
+}
+
+bool Profiler::WriteReports(const std::string& prefix) const {
+    std::ofstream flat(prefix + ".profile.txt");
+    std::ofstream folded(prefix + ".folded");
+    if (!flat || !folded) return false;
+    WriteFlat(flat);
+    WriteFolded(folded);
+    return flat.good() && folded.good();
+}
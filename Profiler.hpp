@@ -0,0 +1,105 @@
+#pragma once
+#include "CPU.hpp"
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CPU {
+    // Perfil del programa emulado. Solo se engancha si se compila con -DEMU_PROFILER:
+    // sin ese flag Processor no tiene ni el puntero ni los hooks.
+    // Cuenta instrucciones y ciclos de maquina por (banco, PC) y por opcode, y sigue la pila
+    // de llamadas (CALL/RST/interrupciones entran, RET/RETI salen) como un arbol de
+    // llamadas. Una direccion de codigo es (banco << 16 | PC): banco 0 para 0x0000-0x3FFF y
+    // la RAM, el banco mapeado en 0x4000-0x7FFF, igual que los .sym de RGBDS.
+    class Profiler {
+        public:
+        struct Counter {
+            u64 instructions = 0;
+            u64 cycles = 0;
+        };
+        static constexpr size_t MAX_DEPTH = 256;
+        static u32 Key(u8 bank, u16 pc) { return ((u32)bank << 16) | pc; }
+        static u8 BankOf(u16 pc, u8 rom_bank) { return pc >= 0x4000 && pc < 0x8000 ? rom_bank : 0; }
+
+        private:
+        // Contadores planos: 0x0000-0x3FFF, 0x8000-0xFFFF, y un bloque por banco de ROMX
+        // que se reserva la primera vez que se ejecuta algo en el
+        std::unique_ptr<Counter[]> low;
+        std::unique_ptr<Counter[]> high;
+        std::vector<std::unique_ptr<Counter[]>> banks;
+        Counter opcodes[256];
+        Counter cb_opcodes[256];
+        u64 interrupts[5] = {};
+        u64 halt_cycles = 0;
+        u64 overflows = 0;      // Veces que la pila paso MAX_DEPTH (se vacio)
+
+        // Arbol de llamadas: nodo = funcion bajo un padre; el 0 es la raiz
+        struct Node {
+            u32 parent;
+            u32 function;
+            u64 cycles = 0;         // Propios, sin los hijos
+            u64 halt_cycles = 0;
+            u64 calls = 0;
+        };
+        std::vector<Node> nodes;
+        std::unordered_map<u64, u32> children;      // parent << 32 | function -> nodo
+        // sp: el SP antes de apilar la vuelta; el RET que lo restaura cierra el frame
+        struct Frame {
+            u32 node;
+            u16 sp;
+        };
+        std::vector<Frame> stack;
+        u32 current = 0;
+
+        std::map<u32, std::string> symbols;
+
+        Counter& At(u8 rom_bank, u16 pc);
+        void Enter(u32 function, u16 sp);
+        void Leave(u16 sp);
+
+        public:
+        Profiler();
+        void Reset();
+
+        // Desde Processor::Step, despues de ejecutar. cb = segundo byte si opcode es 0xCB.
+        void OnInstruction(u8 rom_bank, u16 pc, u8 opcode, u8 cb, int cycles, u16 old_sp, u16 new_sp, u16 new_pc) {
+            Counter& location = At(rom_bank, pc);
+            location.instructions++;
+            location.cycles += cycles;
+            Counter& op = opcode == 0xCB ? cb_opcodes[cb] : opcodes[opcode];
+            op.instructions++;
+            op.cycles += cycles;
+            nodes[current].cycles += cycles;
+
+            bool call = opcode == 0xCD || (opcode & 0xE7) == 0xC4 || (opcode & 0xC7) == 0xC7;
+            bool ret = opcode == 0xC9 || opcode == 0xD9 || (opcode & 0xE7) == 0xC0;
+            if (call && (u16)(old_sp - 2) == new_sp) Enter(Key(BankOf(new_pc, rom_bank), new_pc), old_sp);
+            else if (ret && (u16)(old_sp + 2) == new_sp) Leave(new_sp);
+            else if (opcode == 0x31 || opcode == 0xF9 || opcode == 0xE8) Leave(new_sp);   // Cambio de pila
+        }
+        void OnHalt(int cycles) {
+            halt_cycles += cycles;
+            nodes[current].halt_cycles += cycles;
+        }
+        // Al despachar la interrupcion 'bit' (vector 0x40 + bit * 8); sp antes de apilar PC
+        void OnInterrupt(int bit, u16 sp) {
+            interrupts[bit]++;
+            Enter(Key(0, 0x40 + bit * 8), sp);
+        }
+
+        // .sym de RGBDS: lineas "BB:AAAA Nombre" (';' comenta)
+        bool LoadSymbols(const std::string& path);
+        // Simbolo exacto, o el anterior del mismo banco + desplazamiento, o "BB:AAAA"
+        std::string Name(u32 key) const;
+
+        // Perfil plano: por funcion (arbol), por banco, por PC (los 'top' mas caros) y por opcode
+        void WriteFlat(std::ostream& out, size_t top = 64) const;
+        // Una linea "f1;f2;f3 ciclos" por camino del arbol (flamegraph.pl / speedscope)
+        void WriteFolded(std::ostream& out) const;
+        // <prefijo>.profile.txt y <prefijo>.folded
+        bool WriteReports(const std::string& prefix) const;
+    };
+}
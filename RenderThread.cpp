@@ -0,0 +1,135 @@
+#include "RenderThread.hpp"
+#include <cstring>
+
+using namespace CPU;
+
+RenderThread::RenderThread() {
+    queue = std::make_unique<SpscQueue<RenderCommand, QUEUE_SIZE>>();
+    shadow_bus = std::make_unique<Memory_Bus>();
+    shadow_ppu = std::make_unique<PPU>();
+}
+
+RenderThread::~RenderThread() {
+    Stop();
+}
+
+void RenderThread::Start(const Memory_Bus& bus, const PPU& ppu) {
+    Stop();
+
+    // Por Write para que la cache de tiles y el indice de sprites del espejo queden al dia
+    const u8* vram = bus.GetVRAM();
+    const u8* oam = bus.GetOAM();
+    for (int i = 0; i < 0x2000; i++) shadow_bus->Write(0x8000 + i, vram[i]);
+    for (int i = 0; i < 0xA0; i++) shadow_bus->Write(0xFE00 + i, oam[i]);
+    shadow_bus->SetLCD(bus.GetLCD());
+    *shadow_ppu = ppu;
+    shadow_ppu->SetRenderThread(nullptr);
+
+    {
+        std::lock_guard<std::mutex> guard(frame_lock);
+        std::memcpy(published, ppu.GetFrame(), sizeof(published));
+    }
+    published_serial.store(ppu.FrameSerial(), std::memory_order_release);
+
+    worker = std::thread(&RenderThread::Run, this);
+}
+
+void RenderThread::Stop() {
+    if (!worker.joinable()) return;
+    RenderCommand stop = {};
+    stop.type = RenderCommand::STOP;
+    Push(stop);
+    worker.join();
+}
+
+void RenderThread::Push(const RenderCommand& command) {
+    while (!queue->Push(command)) {
+        queue_stalls++;
+        wake.notify_one();
+        std::this_thread::yield();
+    }
+    submitted.fetch_add(1, std::memory_order_relaxed);
+
+    if (sleeping.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        wake.notify_one();
+    }
+}
+
+void RenderThread::SubmitLine(Memory_Bus& bus, u8 line) {
+    RenderCommand command = {};
+    command.type = RenderCommand::WRITE;
+    for (u32 write : bus.VideoWrites()) {
+        command.address = (u16)(write >> 8);
+        command.value = (u8)write;
+        Push(command);
+    }
+    bus.VideoWrites().clear();
+
+    command.type = RenderCommand::LINE;
+    command.line = line;
+    command.lcd = bus.GetLCD();
+    Push(command);
+}
+
+void RenderThread::SubmitFrame() {
+    RenderCommand command = {};
+    command.type = RenderCommand::FRAME;
+    Push(command);
+}
+
+void RenderThread::Flush() {
+    while (consumed.load(std::memory_order_acquire) != submitted.load(std::memory_order_relaxed)) {
+        wake.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void RenderThread::Run() {
+    RenderCommand command;
+    int idle_spins = 0;
+
+    while (true) {
+        if (!queue->Pop(command)) {
+            // Un rato de yield antes de dormir: entre lineas la espera es corta
+            if (++idle_spins < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(wake_lock);
+            sleeping.store(true, std::memory_order_release);
+            wake.wait_for(guard, std::chrono::milliseconds(1), [this] { return queue->Size() > 0; });
+            sleeping.store(false, std::memory_order_release);
+            continue;
+        }
+        idle_spins = 0;
+
+        switch (command.type) {
+            case RenderCommand::WRITE:
+                shadow_bus->Write(command.address, command.value);
+                break;
+            case RenderCommand::LINE:
+                shadow_bus->SetLCD(command.lcd);
+                shadow_ppu->RenderScanline(*shadow_bus, command.line);
+                break;
+            case RenderCommand::FRAME:
+                shadow_ppu->CompleteFrame();
+                if (shadow_ppu->FrameSerial() != published_serial.load(std::memory_order_relaxed)) {
+                    std::lock_guard<std::mutex> guard(frame_lock);
+                    std::memcpy(published, shadow_ppu->GetFrame(), sizeof(published));
+                    published_serial.store(shadow_ppu->FrameSerial(), std::memory_order_release);
+                }
+                break;
+            case RenderCommand::STOP:
+                consumed.fetch_add(1, std::memory_order_release);
+                return;
+        }
+        consumed.fetch_add(1, std::memory_order_release);
+    }
+}
+
+u32 RenderThread::CopyFrame(u8* dst) const {
+    std::lock_guard<std::mutex> guard(frame_lock);
+    std::memcpy(dst, published, sizeof(published));
+    return published_serial.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "PPU.hpp"
+#include "SpscQueue.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace CPU {
+    // Lo que el hilo de emulacion le manda al de render, en orden
+    struct RenderCommand {
+        enum Type : u8 { WRITE, LINE, FRAME, STOP };
+
+        Type type;
+        u8 line;
+        u16 address;        // WRITE: direccion en VRAM/OAM
+        u8 value;
+        LcdRegisters lcd;   // LINE: registros al final del DRAWING de esa linea
+    };
+
+    // Render de scanlines en otro hilo. El hilo de emulacion solo registra las escrituras
+    // a VRAM/OAM y los registros del LCD de cada linea; el worker los aplica sobre un bus
+    // espejo y dibuja con el mismo RenderScanline, asi el frame es identico al inline.
+    class RenderThread {
+        private:
+        static const size_t QUEUE_SIZE = 1 << 16;
+
+        std::unique_ptr<SpscQueue<RenderCommand, QUEUE_SIZE>> queue;
+        std::unique_ptr<Memory_Bus> shadow_bus;
+        std::unique_ptr<PPU> shadow_ppu;
+        std::thread worker;
+
+        // El worker duerme cuando la cola esta vacia
+        std::mutex wake_lock;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping{false};
+
+        // Frame publicado para el frontend
+        mutable std::mutex frame_lock;
+        u8 published[160 * 144] = {};
+        std::atomic<u32> published_serial{0};
+
+        std::atomic<u64> submitted{0};
+        std::atomic<u64> consumed{0};
+
+        void Push(const RenderCommand& command);
+        void Run();
+
+        public:
+        long long queue_stalls = 0;     // Veces que el productor encontro la cola llena
+
+        RenderThread();
+        ~RenderThread();
+
+        // Copia VRAM/OAM y los buffers de la PPU y arranca el worker
+        void Start(const Memory_Bus& bus, const PPU& ppu);
+        void Stop();
+        bool Running() const { return worker.joinable(); }
+
+        // Hilo de emulacion
+        void SubmitLine(Memory_Bus& bus, u8 line);
+        void SubmitFrame();
+        void Flush();   // Espera a que el worker procese todo lo enviado
+
+        // Frontend (cualquier hilo)
+        u32 FrameSerial() const { return published_serial.load(std::memory_order_acquire); }
+        u32 CopyFrame(u8* dst) const;   // Devuelve el serial del frame copiado
+    };
+}
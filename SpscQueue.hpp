@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace CPU {
+    // Cola lock-free de un productor y un consumidor. N tiene que ser potencia de 2.
+    // Los indices crecen sin limite y se enmascaran al indexar; Push/Pop nunca bloquean.
+    template <typename T, size_t N>
+    class SpscQueue {
+        static_assert((N & (N - 1)) == 0, "N tiene que ser potencia de 2");
+
+        private:
+        alignas(64) std::atomic<size_t> head{0};    // Proximo a escribir (productor)
+        alignas(64) std::atomic<size_t> tail{0};    // Proximo a leer (consumidor)
+        alignas(64) T items[N];
+
+        public:
+        bool Push(const T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == N) return false;
+            items[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) return false;
+            item = items[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // En bloque: una sola publicacion del indice por llamada. Devuelven cuantos pasaron.
+        size_t PushMany(const T* src, size_t count) {
+            size_t h = head.load(std::memory_order_relaxed);
+            size_t space = N - (h - tail.load(std::memory_order_acquire));
+            if (count > space) count = space;
+            for (size_t i = 0; i < count; i++) items[(h + i) & (N - 1)] = src[i];
+            head.store(h + count, std::memory_order_release);
+            return count;
+        }
+
+        size_t PopMany(T* dst, size_t max) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t available = head.load(std::memory_order_acquire) - t;
+            if (max > available) max = available;
+            for (size_t i = 0; i < max; i++) dst[i] = items[(t + i) & (N - 1)];
+            tail.store(t + max, std::memory_order_release);
+            return max;
+        }
+
+        // Se puede llamar desde un tercer hilo: tail primero, porque nunca pasa a un head leido
+        // despues (al reves la resta da la vuelta). Entre las dos lecturas el productor pudo
+        // avanzar contra un tail mas nuevo, asi que se recorta a N.
+        size_t Size() const {
+            size_t t = tail.load(std::memory_order_acquire);
+            size_t size = head.load(std::memory_order_acquire) - t;
+            return size < N ? size : N;
+        }
+        static constexpr size_t Capacity() { return N; }
+    };
+}
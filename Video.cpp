@@ -0,0 +1,93 @@
+#include "Video.hpp"
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+using namespace CPU;
+
+const Palette CPU::PALETTE_GRAY = {{0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555, 0xFF000000}};
+const Palette CPU::PALETTE_GREEN = {{0xFF9BBC0F, 0xFF8BAC0F, 0xFF306230, 0xFF0F380F}};
+
+bool CPU::FindPalette(const std::string& name, Palette& palette) {
+    if (name == "gray") palette = PALETTE_GRAY;
+    else if (name == "green") palette = PALETTE_GREEN;
+    else return false;
+    return true;
+}
+
+int CPU::BytesPerPixel(PixelFormat format) {
+    switch (format) {
+        case PIXEL_ARGB8888: return 4;
+        case PIXEL_RGB565: return 2;
+        case PIXEL_GRAY8: return 1;
+    }
+    return 0;
+}
+
+static u16 ToRGB565(u32 argb) {
+    u32 r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+    return (u16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static u8 ToGray(u32 argb) {
+    u32 r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+    return (u8)((r * 77 + g * 150 + b * 29) >> 8);
+}
+
+// La paleta ya convertida queda como tabla de 16 bytes: el byte b del tono i esta en
+// i * bytes_por_pixel + b, asi una fila se expande con pshufb (16 pixeles por vuelta).
+static void ExpandRow(const u8* src, u8* dst, int bpp, const u8* table) {
+    int x = 0;
+#if defined(__SSSE3__)
+    __m128i lut = _mm_loadu_si128((const __m128i*)table);
+    if (bpp == 4) {
+        const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+        for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+            __m128i idx = _mm_loadu_si128((const __m128i*)(src + x));
+            for (int part = 0; part < 4; part++) {
+                // Cada indice repetido 4 veces, * 4 + byte dentro del pixel
+                __m128i rep = _mm_shuffle_epi8(idx, _mm_add_epi8(_mm_set1_epi8(part * 4),
+                              _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3)));
+                rep = _mm_or_si128(_mm_slli_epi16(rep, 2), lanes);
+                _mm_storeu_si128((__m128i*)(dst + (x + part * 4) * 4), _mm_shuffle_epi8(lut, rep));
+            }
+        }
+    } else if (bpp == 2) {
+        const __m128i lanes = _mm_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1);
+        for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+            __m128i idx = _mm_loadu_si128((const __m128i*)(src + x));
+            for (int part = 0; part < 2; part++) {
+                __m128i rep = _mm_shuffle_epi8(idx, _mm_add_epi8(_mm_set1_epi8(part * 8),
+                              _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7)));
+                rep = _mm_or_si128(_mm_slli_epi16(rep, 1), lanes);
+                _mm_storeu_si128((__m128i*)(dst + (x + part * 8) * 2), _mm_shuffle_epi8(lut, rep));
+            }
+        }
+    } else {
+        for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+            __m128i idx = _mm_loadu_si128((const __m128i*)(src + x));
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_shuffle_epi8(lut, idx));
+        }
+    }
+#endif
+    for (; x < SCREEN_WIDTH; x++) std::memcpy(dst + x * bpp, table + (src[x] & 0x03) * bpp, bpp);
+}
+
+void CPU::ExpandFrame(const u8* frame, void* dst, int pitch, PixelFormat format, const Palette& palette) {
+    int bpp = BytesPerPixel(format);
+    if (bpp == 0) return;
+
+    u8 table[16] = {};
+    for (int i = 0; i < 4; i++) {
+        if (format == PIXEL_ARGB8888) std::memcpy(table + i * 4, &palette.argb[i], 4);
+        else if (format == PIXEL_RGB565) {
+            u16 color = ToRGB565(palette.argb[i]);
+            std::memcpy(table + i * 2, &color, 2);
+        } else table[i] = ToGray(palette.argb[i]);
+    }
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ExpandRow(frame + y * SCREEN_WIDTH, (u8*)dst + y * pitch, bpp, table);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "CPU.hpp"
+
+namespace CPU {
+    const int SCREEN_WIDTH = 160;
+    const int SCREEN_HEIGHT = 144;
+
+    enum PixelFormat {
+        PIXEL_ARGB8888  = 0,
+        PIXEL_RGB565    = 1,
+        PIXEL_GRAY8     = 2     // Luminancia de la paleta, para observaciones de ML
+    };
+
+    // Color 0xAARRGGBB de cada tono, del 0 (mas claro) al 3
+    struct Palette {
+        u32 argb[4];
+    };
+    extern const Palette PALETTE_GRAY;
+    extern const Palette PALETTE_GREEN;     // Tonos de la pantalla del DMG
+    bool FindPalette(const std::string& name, Palette& palette);
+
+    int BytesPerPixel(PixelFormat format);
+
+    // Expande un frame indexado (160x144, un tono por byte) al formato pedido.
+    // Solo lee 'frame', asi que se puede llamar desde cualquier hilo sobre un frame completo.
+    void ExpandFrame(const u8* frame, void* dst, int pitch, PixelFormat format, const Palette& palette);
+}
@@ -0,0 +1,75 @@
+// Pruebas de las vistas de memoria de EmuAPI. Se compila con las mismas fuentes que libemu:
+// g++ -std=c++17 -I. tests/EmuAPITest.cpp CPU.cpp PPU.cpp APU.cpp BlipBuffer.cpp AudioOutput.cpp
+//     Video.cpp RenderThread.cpp GameBoy.cpp EmuAPI.cpp -lSDL2 -pthread -o emu_api_test
+#include "EmuAPI.h"
+#include <cstdio>
+#include <vector>
+
+// ROM minima: paletas identidad, LCD con fondo y sprites (tiles en 0x8000) y un bucle
+static std::vector<uint8_t> MakeRom() {
+    std::vector<uint8_t> rom(0x8000, 0x00);
+    const uint8_t entry[] = {0x00, 0xC3, 0x50, 0x01};                  // NOP; JP 0x0150
+    const uint8_t code[] = {
+        0x3E, 0xE4, 0xE0, 0x47, 0xE0, 0x48,                             // BGP = OBP0 = 0xE4
+        0x3E, 0x93, 0xE0, 0x40,                                         // LCDC = 0x93
+        0x18, 0xFE                                                      // JR -2
+    };
+    for (size_t i = 0; i < sizeof(entry); i++) rom[0x100 + i] = entry[i];
+    for (size_t i = 0; i < sizeof(code); i++) rom[0x150 + i] = code[i];
+    return rom;
+}
+
+static bool Check(bool ok, const char* name) {
+    std::printf("%s: %s\n", ok ? "OK   " : "FALLA", name);
+    return ok;
+}
+
+// El pixel (x, y) del ultimo frame
+static uint8_t Pixel(emu_instance* emu, int x, int y) {
+    emu_view frame = emu_framebuffer(emu);
+    return ((const uint8_t*)frame.data)[y * 160 + x];
+}
+
+// Escribir un tile por la vista de VRAM y despues pedir la de OAM no pierde la escritura
+static bool VramThenOam(const std::vector<uint8_t>& rom) {
+    emu_instance* emu = emu_create();
+    emu_load_rom(emu, rom.data(), rom.size());
+    emu_run_frames(emu, 2);                 // El tile 0 (vacio) ya esta en la cache
+
+    emu_view vram = emu_memory(emu, EMU_REGION_VRAM);
+    for (int i = 0; i < 16; i++) ((uint8_t*)vram.data)[i] = 0xFF;
+    emu_memory(emu, EMU_REGION_OAM);
+    emu_run_frames(emu, 1);
+
+    bool ok = Pixel(emu, 0, 0) == 3 && Pixel(emu, 159, 143) == 3;
+    emu_destroy(emu);
+    return Check(ok, "tile escrito por VRAM antes de exponer OAM");
+}
+
+// Escribir un sprite por la vista de OAM y despues pedir la de VRAM no pierde la escritura
+static bool OamThenVram(const std::vector<uint8_t>& rom) {
+    emu_instance* emu = emu_create();
+    emu_load_rom(emu, rom.data(), rom.size());
+    emu_view oam = emu_memory(emu, EMU_REGION_OAM);
+    emu_run_frames(emu, 2);                 // Indice de sprites armado con la OAM vacia
+
+    uint8_t* sprite = (uint8_t*)oam.data;
+    sprite[0] = 16;                         // Esquina superior izquierda, tile 1
+    sprite[1] = 8;
+    sprite[2] = 1;
+    sprite[3] = 0;
+    emu_view vram = emu_memory(emu, EMU_REGION_VRAM);
+    for (int i = 16; i < 32; i++) ((uint8_t*)vram.data)[i] = 0xFF;
+    emu_run_frames(emu, 1);
+
+    bool ok = Pixel(emu, 0, 0) == 3 && Pixel(emu, 7, 7) == 3 && Pixel(emu, 8, 8) == 0;
+    emu_destroy(emu);
+    return Check(ok, "sprite escrito por OAM antes de exponer VRAM");
+}
+
+int main() {
+    std::vector<uint8_t> rom = MakeRom();
+    bool ok = VramThenOam(rom);
+    ok = OamThenVram(rom) && ok;
+    return ok ? 0 : 1;
+}